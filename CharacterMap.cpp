@@ -0,0 +1,47 @@
+// ==========================================================================
+// Character Map Table
+//
+// A dense copy of a face's character map, built once when the font is
+// loaded. The Unicode range is split into pages of 256 code points; each
+// page that maps anything gets its own array of glyph indices, and every
+// page that maps nothing points at one shared page of zeros. Looking up a
+// glyph index is then a page lookup and an indexed load, instead of a search
+// through the font's cmap subtable with FT_Get_Char_Index.
+// ==========================================================================
+
+#include "CharacterMap.h"
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+CharacterMap::CharacterMap()
+    : m_mapped(0)
+{}
+
+void CharacterMap::Build(FT_Face face)
+{
+    // every page starts out pointing at the shared empty page
+    m_pages.assign(CODE_POINTS / PAGE_SIZE, 0);
+    m_indices.assign(PAGE_SIZE, 0);
+    m_mapped = 0;
+
+    FT_UInt index;
+    FT_ULong c = FT_Get_First_Char(face, &index);
+    while (index != 0)
+    {
+        if (c < CODE_POINTS)
+        {
+            unsigned int &page = m_pages[c >> PAGE_BITS];
+            if (page == 0) {
+                page = m_indices.size();
+                m_indices.resize(m_indices.size() + PAGE_SIZE, 0);
+            }
+            m_indices[page + (c & (PAGE_SIZE - 1))] = index;
+            ++m_mapped;
+        }
+        c = FT_Get_Next_Char(face, c, &index);
+    }
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,59 @@
+// ==========================================================================
+// Character Map Table
+//
+// A dense copy of a face's character map, built once when the font is
+// loaded. The Unicode range is split into pages of 256 code points; each
+// page that maps anything gets its own array of glyph indices, and every
+// page that maps nothing points at one shared page of zeros. Looking up a
+// glyph index is then a page lookup and an indexed load, instead of a search
+// through the font's cmap subtable with FT_Get_Char_Index.
+// ==========================================================================
+#ifndef CHARACTERMAP_H
+#define CHARACTERMAP_H
+
+#include <vector>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+// --------------------------------------------------------------------------
+
+class CharacterMap
+{
+public:
+    static const unsigned int CODE_POINTS = 0x110000;
+    static const unsigned int PAGE_BITS = 8;
+    static const unsigned int PAGE_SIZE = 1 << PAGE_BITS;
+
+private:
+    // where each page starts in the storage; page 0 of storage is all zeros
+    std::vector<unsigned int> m_pages;
+    std::vector<unsigned short> m_indices;
+    unsigned int m_mapped;
+
+public:
+    CharacterMap();
+
+    // fills the table from the face's selected character map
+    void Build(FT_Face face);
+
+    // glyph index for a code point, 0 (the missing glyph) if unmapped
+    unsigned int GlyphIndex(int character) const
+    {
+        unsigned int c = character;
+        if (c >= CODE_POINTS || m_pages.empty()) return 0;
+        return m_indices[m_pages[c >> PAGE_BITS] + (c & (PAGE_SIZE - 1))];
+    }
+
+    // number of code points that map to a glyph
+    unsigned int MappedCount() const    { return m_mapped; }
+
+    size_t BytesUsed() const
+    {
+        return m_pages.size() * sizeof(unsigned int)
+             + m_indices.size() * sizeof(unsigned short);
+    }
+};
+
+// --------------------------------------------------------------------------
+#endif // CHARACTERMAP_H
@@ -0,0 +1,277 @@
+// ==========================================================================
+// Compact Outline Storage
+//
+// Stores glyph outlines the way the font does, rather than as MySegments:
+// each point is a pair of 16-bit integers in font units, the on/off-curve
+// tags that decide segment degrees are packed 2 bits per point in a separate
+// array, and each contour is just the index of its last point. A line costs
+// one point, a quadratic one or two, and a cubic three, instead of a fixed
+// 36-byte MySegment, so large character sets take a fraction of the memory.
+//
+// Contours are stored once however many glyphs use them. Each is kept with
+// its points relative to its first point and found again by a hash of those
+// points and tags, so a contour that turns up again, even moved (the base
+// letter of an accented character, or an accent over a different letter),
+// costs only a reference: the contour and where its first point goes.
+//
+// Stored glyphs are decoded on demand into the usual MyOutline view, using
+// the same conversion as GlyphExtractor so the segments are identical.
+// ==========================================================================
+
+#include "CompactOutline.h"
+#include "OutlineDecoder.h"
+#include <algorithm>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+// the glyph being decoded, put back together from its contours in font
+// units, and its points converted; one set of buffers per thread
+static thread_local vector<short> s_coords;
+static thread_local vector<unsigned char> s_tags;
+static thread_local vector<unsigned short> s_ends;
+static thread_local EMOutlineBuffer s_converted;
+
+// the contour being added, relative to its first point
+static thread_local vector<short> s_contourCoords;
+static thread_local vector<unsigned char> s_contourTags;
+
+static bool FitsShort(long v)
+{
+    return v >= -32768 && v <= 32767;
+}
+
+// --------------------------------------------------------------------------
+
+CompactOutlineStore::CompactOutlineStore()
+    : m_contourUses(0)
+{
+    Clear();
+}
+
+unsigned int CompactOutlineStore::Hash(const short *coords, const unsigned char *tags,
+                                       int points) const
+{
+    // FNV-1a over the point count, the coordinates and the packed tags
+    unsigned int hash = 2166136261u;
+    hash = (hash ^ points) * 16777619u;
+    for (int i = 0; i < 2 * points; ++i)
+        hash = (hash ^ (unsigned short)coords[i]) * 16777619u;
+    for (int i = 0; i < (points + 3) / 4; ++i)
+        hash = (hash ^ tags[i]) * 16777619u;
+    return hash;
+}
+
+void CompactOutlineStore::Rehash(size_t slots)
+{
+    m_table.assign(slots, 0);
+    for (unsigned int c = 0; c + 1 < m_contours.size(); ++c)
+    {
+        const Contour &contour = m_contours[c];
+        int points = m_contours[c + 1].pointBegin - contour.pointBegin;
+        size_t slot = Hash(&m_coords[2 * contour.pointBegin], &m_tags[contour.tagBegin], points)
+                    & (slots - 1);
+        while (m_table[slot]) slot = (slot + 1) & (slots - 1);
+        m_table[slot] = c + 1;
+    }
+}
+
+unsigned int CompactOutlineStore::FindOrAddContour(const short *coords,
+                                                   const unsigned char *tags, int points)
+{
+    ++m_contourUses;
+    size_t tagBytes = (points + 3) / 4;
+    size_t mask = m_table.size() - 1;
+    size_t slot = Hash(coords, tags, points) & mask;
+
+    for (; m_table[slot]; slot = (slot + 1) & mask)
+    {
+        unsigned int c = m_table[slot] - 1;
+        const Contour &contour = m_contours[c];
+        if (int(m_contours[c + 1].pointBegin - contour.pointBegin) == points &&
+            equal(coords, coords + 2 * points, &m_coords[2 * contour.pointBegin]) &&
+            equal(tags, tags + tagBytes, &m_tags[contour.tagBegin]))
+            return c;
+    }
+
+    // a new contour takes the place of the end marker, and a new marker
+    // goes after it
+    unsigned int c = m_contours.size() - 1;
+    m_coords.insert(m_coords.end(), coords, coords + 2 * points);
+    m_tags.insert(m_tags.end(), tags, tags + tagBytes);
+    Contour end;
+    end.pointBegin = m_coords.size() / 2;
+    end.tagBegin = m_tags.size();
+    m_contours.push_back(end);
+    m_table[slot] = c + 1;
+
+    // the table is kept at most half full
+    if (2 * m_contours.size() > m_table.size())
+        Rehash(2 * m_table.size());
+    return c;
+}
+
+bool CompactOutlineStore::Add(unsigned long long key, const FT_Outline &outline,
+                              long advance, int em)
+{
+    if (!FitsShort(advance) || em > 65535)
+        return false;
+    // every point, and every point relative to the start of its contour,
+    // must fit before anything is stored
+    int begin = 0;
+    for (int c = 0; c < outline.n_contours; ++c)
+    {
+        const FT_Vector &first = outline.points[begin];
+        for (int p = begin; p <= outline.contours[c]; ++p) {
+            const FT_Vector &point = outline.points[p];
+            if (!FitsShort(point.x) || !FitsShort(point.y) ||
+                !FitsShort(point.x - first.x) || !FitsShort(point.y - first.y))
+                return false;
+        }
+        begin = outline.contours[c] + 1;
+    }
+
+    CompactGlyph glyph;
+    glyph.refBegin = m_refs.size();
+    glyph.pointCount = outline.n_points;
+    glyph.contourCount = outline.n_contours;
+    glyph.advance = short(advance);
+    glyph.em = em;
+
+    begin = 0;
+    for (int c = 0; c < outline.n_contours; ++c)
+    {
+        int end = outline.contours[c];
+        int points = end - begin + 1;
+        const FT_Vector &first = outline.points[begin];
+
+        s_contourCoords.clear();
+        for (int p = begin; p <= end; ++p) {
+            s_contourCoords.push_back(short(outline.points[p].x - first.x));
+            s_contourCoords.push_back(short(outline.points[p].y - first.y));
+        }
+
+        // keep only the on-curve and cubic bits of each tag
+        s_contourTags.assign((points + 3) / 4, 0);
+        for (int p = 0; p < points; ++p)
+            s_contourTags[p >> 2] |= (outline.tags[begin + p] & 3) << ((p & 3) * 2);
+
+        ContourRef ref;
+        ref.contour = FindOrAddContour(&s_contourCoords[0], &s_contourTags[0], points);
+        ref.x = short(first.x);
+        ref.y = short(first.y);
+        m_refs.push_back(ref);
+
+        begin = end + 1;
+    }
+
+    m_index[key] = m_glyphs.size();
+    m_glyphs.push_back(glyph);
+    return true;
+}
+
+void CompactOutlineStore::AddEmpty(unsigned long long key, long advance, int em)
+{
+    CompactGlyph glyph;
+    glyph.refBegin = m_refs.size();
+    glyph.pointCount = 0;
+    glyph.contourCount = 0;
+    glyph.advance = FitsShort(advance) ? short(advance) : 0;
+    glyph.em = em;
+
+    m_index[key] = m_glyphs.size();
+    m_glyphs.push_back(glyph);
+}
+
+const CompactGlyph *CompactOutlineStore::Find(unsigned long long key) const
+{
+    unordered_map<unsigned long long, unsigned int>::const_iterator it = m_index.find(key);
+    return it == m_index.end() ? 0 : &m_glyphs[it->second];
+}
+
+// --------------------------------------------------------------------------
+
+void CompactOutlineStore::Decode(const CompactGlyph &glyph,
+                                 vector<MySegment> &segments,
+                                 vector<MyContourSpan> &contours,
+                                 MyOutline &outline, float tolerance) const
+{
+    float em = glyph.em ? glyph.em : 1;
+
+    segments.clear();
+    contours.clear();
+
+    if (glyph.contourCount)
+    {
+        // put the glyph's points back together in font units, so they are
+        // converted exactly as if they had been stored as they were
+        s_coords.resize(2 * glyph.pointCount);
+        s_tags.assign((glyph.pointCount + 3) / 4, 0);
+        s_ends.resize(glyph.contourCount);
+
+        int point = 0;
+        for (unsigned int c = 0; c < glyph.contourCount; ++c)
+        {
+            const ContourRef &ref = m_refs[glyph.refBegin + c];
+            const Contour &contour = m_contours[ref.contour];
+            int points = m_contours[ref.contour + 1].pointBegin - contour.pointBegin;
+            const short *coords = &m_coords[2 * contour.pointBegin];
+            const unsigned char *tags = &m_tags[contour.tagBegin];
+
+            for (int p = 0; p < points; ++p, ++point) {
+                s_coords[2 * point] = short(coords[2 * p] + ref.x);
+                s_coords[2 * point + 1] = short(coords[2 * p + 1] + ref.y);
+                int tag = (tags[p >> 2] >> ((p & 3) * 2)) & 3;
+                s_tags[point >> 2] |= tag << ((point & 3) * 2);
+            }
+            s_ends[c] = point - 1;
+        }
+
+        ConvertToEM(&s_coords[0], &s_tags[0], glyph.pointCount, em, s_converted);
+        EMOutlineSource<unsigned short> source(s_converted, &s_ends[0], glyph.contourCount);
+
+        FlatSink sink(segments, contours);
+        if (tolerance > 0) {
+            QuadraticSink<FlatSink> quadratic(sink, tolerance);
+            DecodeOutline(source, 1.0f, quadratic);
+        }
+        else
+            DecodeOutline(source, 1.0f, sink);
+    }
+
+    outline.advance = glyph.advance / em;
+    outline.segments = segments.empty() ? 0 : &segments[0];
+    outline.segmentCount = segments.size();
+    outline.contours = contours.empty() ? 0 : &contours[0];
+    outline.contourCount = contours.size();
+}
+
+// --------------------------------------------------------------------------
+
+size_t CompactOutlineStore::BytesUsed() const
+{
+    return m_coords.size() * sizeof(short)
+         + m_tags.size()
+         + m_contours.size() * sizeof(Contour)
+         + m_refs.size() * sizeof(ContourRef)
+         + m_glyphs.size() * sizeof(CompactGlyph)
+         + m_table.size() * sizeof(unsigned int);
+}
+
+void CompactOutlineStore::Clear()
+{
+    m_coords.clear();
+    m_tags.clear();
+    m_refs.clear();
+    m_glyphs.clear();
+    m_index.clear();
+    m_contourUses = 0;
+
+    // no contours yet, just the end marker
+    Contour end = { 0, 0 };
+    m_contours.assign(1, end);
+    m_table.assign(16, 0);
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,114 @@
+// ==========================================================================
+// Compact Outline Storage
+//
+// Stores glyph outlines the way the font does, rather than as MySegments:
+// each point is a pair of 16-bit integers in font units, the on/off-curve
+// tags that decide segment degrees are packed 2 bits per point in a separate
+// array, and each contour is just the index of its last point. A line costs
+// one point, a quadratic one or two, and a cubic three, instead of a fixed
+// 36-byte MySegment, so large character sets take a fraction of the memory.
+//
+// Contours are stored once however many glyphs use them. Each is kept with
+// its points relative to its first point and found again by a hash of those
+// points and tags, so a contour that turns up again, even moved (the base
+// letter of an accented character, or an accent over a different letter),
+// costs only a reference: the contour and where its first point goes.
+//
+// Stored glyphs are decoded on demand into the usual MyOutline view, using
+// the same conversion as GlyphExtractor so the segments are identical.
+// ==========================================================================
+#ifndef COMPACTOUTLINE_H
+#define COMPACTOUTLINE_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+// Where one glyph's data lives within the store's arrays.
+
+struct CompactGlyph
+{
+    unsigned int   refBegin;        // first of its contour references
+    unsigned short pointCount;
+    unsigned short contourCount;
+    short          advance;         // advance width in font units
+    unsigned short em;              // units per EM of the face
+};
+
+// --------------------------------------------------------------------------
+
+class CompactOutlineStore
+{
+    // a unique contour: where its points and tags start; it ends where the
+    // next one starts, and a last entry marks the end of the arrays
+    struct Contour
+    {
+        unsigned int pointBegin;
+        unsigned int tagBegin;      // contours start on a byte
+    };
+
+    // a glyph's use of a contour, and the position of its first point
+    struct ContourRef
+    {
+        unsigned int contour;
+        short x, y;
+    };
+
+    std::vector<short>          m_coords;       // x, y for every point
+    std::vector<unsigned char>  m_tags;         // 2-bit tags, 4 points per byte
+    std::vector<Contour>        m_contours;
+    std::vector<ContourRef>     m_refs;
+    std::vector<CompactGlyph>   m_glyphs;
+
+    // open-addressed hash table of contours, by their points and tags: each
+    // slot holds a contour index plus one, or 0 if empty
+    std::vector<unsigned int>   m_table;
+
+    // contour references made, counting those to contours already stored
+    size_t m_contourUses;
+
+    // glyph records by caller-chosen key
+    std::unordered_map<unsigned long long, unsigned int> m_index;
+
+    unsigned int Hash(const short *coords, const unsigned char *tags, int points) const;
+    unsigned int FindOrAddContour(const short *coords, const unsigned char *tags, int points);
+    void Rehash(size_t slots);
+
+public:
+    CompactOutlineStore();
+
+    // encodes an outline in font units under the given key; returns false,
+    // storing nothing, if it does not fit in 16-bit coordinates
+    bool Add(unsigned long long key, const FT_Outline &outline,
+             long advance, int em);
+
+    // stores an empty glyph under the given key (for missing characters)
+    void AddEmpty(unsigned long long key, long advance, int em);
+
+    // returns the glyph stored under the given key, or null
+    const CompactGlyph *Find(unsigned long long key) const;
+
+    // decodes a stored glyph into the given buffers and points the outline
+    // at them; the outline is valid until the buffers are next modified.
+    // Cubics are approximated by quadratics within tolerance if it is above 0.
+    void Decode(const CompactGlyph &glyph,
+                std::vector<MySegment> &segments,
+                std::vector<MyContourSpan> &contours,
+                MyOutline &outline, float tolerance = 0) const;
+
+    // memory held by the stored outlines, in bytes
+    size_t BytesUsed() const;
+    size_t GlyphCount() const   { return m_glyphs.size(); }
+
+    // contours stored, and contours used by glyphs; the difference is how
+    // many were shared rather than stored again
+    size_t UniqueContours() const   { return m_contours.empty() ? 0 : m_contours.size() - 1; }
+    size_t ContourUses() const      { return m_contourUses; }
+
+    void Clear();
+};
+
+// --------------------------------------------------------------------------
+#endif // COMPACTOUTLINE_H
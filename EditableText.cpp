@@ -0,0 +1,286 @@
+// ==========================================================================
+// Editable Text
+//
+// A line of text that can be edited in place and drawn without rebuilding
+// it. The glyphs are kept in a gap buffer, each with its own slot: a fixed
+// range of one vertex buffer holding its patches, built at the origin.
+// Inserting characters extracts and uploads only the new glyphs, into free
+// slots with glBufferSubData; erasing just frees slots. Only the kerning of
+// the pairs around the edit is looked up again. Each glyph is placed when
+// it is drawn, by the vertex shader's offset uniform, from the running sum
+// of advances, so the glyphs after an edit move over without being touched.
+// ==========================================================================
+
+#include "EditableText.h"
+#include "TextGeometry.h"
+#include "Utf8.h"
+#include <iostream>
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+
+static const GLuint VERTEX_INDEX = 0;
+static const GLuint COLOUR_INDEX = 1;
+
+EditableText::EditableText(float scale, unsigned int slotVertices)
+    : m_vertexBuffer(0), m_colourBuffer(0), m_vertexArray(0),
+      m_slotCount(0), m_slotVertices(slotVertices), m_patchSize(0),
+      m_scale(scale), m_colour(1.0f, 1.0f, 1.0f),
+      m_uploads(0), m_bytesUploaded(0)
+{}
+
+EditableText::~EditableText()
+{
+    Destroy();
+}
+
+bool EditableText::Initialize(unsigned int slots)
+{
+    glGenVertexArrays(1, &m_vertexArray);
+    return GrowBuffers(slots);
+}
+
+void EditableText::Destroy()
+{
+    if (!m_vertexArray)
+        return;
+
+    glDeleteVertexArrays(1, &m_vertexArray);
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_colourBuffer);
+    m_vertexArray = m_vertexBuffer = m_colourBuffer = 0;
+
+    m_glyphs.Clear();
+    m_freeSlots.clear();
+    m_slotCount = 0;
+}
+
+// --------------------------------------------------------------------------
+
+bool EditableText::GrowBuffers(unsigned int slotCount)
+{
+    GLsizeiptr vertices = GLsizeiptr(slotCount) * m_slotVertices;
+    GLsizeiptr kept = GLsizeiptr(m_slotCount) * m_slotVertices;
+
+    GLuint buffers[2];
+    glGenBuffers(2, buffers);
+
+    // the new buffers take over the old ones' contents on the GPU, so no
+    // glyph has to be built again
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[0]);
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeof(vec2) * vertices, 0, GL_DYNAMIC_DRAW);
+    if (m_vertexBuffer) {
+        glBindBuffer(GL_COPY_READ_BUFFER, m_vertexBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(vec2) * kept);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeof(vec3) * vertices, 0, GL_DYNAMIC_DRAW);
+    if (m_colourBuffer) {
+        glBindBuffer(GL_COPY_READ_BUFFER, m_colourBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(vec3) * kept);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // the old buffers and slots stay in use if the new ones can't be made
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        glDeleteBuffers(2, buffers);
+        cout << "EditableText ERROR: Could not grow buffers to " << slotCount
+             << " glyphs (OpenGL error " << error << ")" << endl;
+        return false;
+    }
+
+    if (m_vertexBuffer) glDeleteBuffers(1, &m_vertexBuffer);
+    if (m_colourBuffer) glDeleteBuffers(1, &m_colourBuffer);
+    m_vertexBuffer = buffers[0];
+    m_colourBuffer = buffers[1];
+
+    glBindVertexArray(m_vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glVertexAttribPointer(VERTEX_INDEX, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+    glEnableVertexAttribArray(VERTEX_INDEX);
+    glBindBuffer(GL_ARRAY_BUFFER, m_colourBuffer);
+    glVertexAttribPointer(COLOUR_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), 0);
+    glEnableVertexAttribArray(COLOUR_INDEX);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    // new slots are handed out lowest first
+    for (unsigned int slot = slotCount; slot > m_slotCount; --slot)
+        m_freeSlots.push_back(slot - 1);
+    m_slotCount = slotCount;
+    return true;
+}
+
+bool EditableText::AllocateSlot(unsigned int &slot)
+{
+    if (m_freeSlots.empty() && !GrowBuffers(m_slotCount > 0 ? m_slotCount * 2 : 64))
+        return false;
+
+    slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+    return true;
+}
+
+void EditableText::Upload(GlyphExtractor &extractor, Glyph &glyph)
+{
+    const MyOutline &outline = extractor.CachedOutline(glyph.character);
+    glyph.advance = outline.advance;
+
+    m_vertices.clear();
+    m_colours.clear();
+    AppendGlyphPatches(outline, 0.0f, 0.0f, m_scale, m_patchSize, m_colour,
+                       m_vertices, m_colours);
+
+    if (m_vertices.size() > m_slotVertices) {
+        cout << "EditableText ERROR: Glyph for character " << glyph.character
+             << " needs " << m_vertices.size() << " vertices, more than the "
+             << m_slotVertices << " in a slot" << endl;
+        glyph.count = 0;
+        return;
+    }
+    glyph.count = m_vertices.size();
+    if (glyph.count == 0)
+        return;
+
+    GLintptr first = GLintptr(glyph.slot) * m_slotVertices;
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(vec2), glyph.count * sizeof(vec2), m_vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, m_colourBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(vec3), glyph.count * sizeof(vec3), m_colours.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    ++m_uploads;
+    m_bytesUploaded += glyph.count * (sizeof(vec2) + sizeof(vec3));
+}
+
+void EditableText::Rekern(GlyphExtractor &extractor, size_t position)
+{
+    Glyph &glyph = m_glyphs[position];
+    glyph.kerning = position + 1 < m_glyphs.Size()
+        ? extractor.GetKerning(glyph.character, m_glyphs[position + 1].character)
+        : 0.0f;
+}
+
+void EditableText::Prepare(GlyphExtractor &extractor, const string &font, int patchSize)
+{
+    extractor.LoadFontFile(font);
+    if (font == m_font && patchSize == m_patchSize)
+        return;
+
+    // every glyph keeps its slot but is built again, with the new font's
+    // advances and kerning
+    m_font = font;
+    m_patchSize = patchSize;
+    for (size_t i = 0; i < m_glyphs.Size(); ++i) {
+        Upload(extractor, m_glyphs[i]);
+        Rekern(extractor, i);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+bool EditableText::Insert(GlyphExtractor &extractor, const string &font, int patchSize,
+                          size_t position, const string &text)
+{
+    if (!m_vertexArray) {
+        cout << "EditableText ERROR: Insert before Initialize" << endl;
+        return false;
+    }
+    Prepare(extractor, font, patchSize);
+    if (position > m_glyphs.Size()) position = m_glyphs.Size();
+
+    vector<int> characters;
+    DecodeUtf8(text, characters);
+    if (characters.empty())
+        return false;
+
+    // slots are all taken before any glyph is built, so running out leaves
+    // the text as it was
+    vector<Glyph> inserted(characters.size());
+    for (size_t i = 0; i < characters.size(); ++i)
+    {
+        if (!AllocateSlot(inserted[i].slot)) {
+            cout << "EditableText ERROR: No room for " << characters.size()
+                 << " more glyphs" << endl;
+            for (size_t j = 0; j < i; ++j)
+                m_freeSlots.push_back(inserted[j].slot);
+            return false;
+        }
+    }
+    for (size_t i = 0; i < characters.size(); ++i)
+    {
+        Glyph &glyph = inserted[i];
+        glyph.character = characters[i];
+        glyph.kerning = 0.0f;
+        Upload(extractor, glyph);
+    }
+    m_glyphs.Insert(position, inserted.data(), inserted.size());
+
+    // kerning changes only for the pairs that now span the inserted run: the
+    // glyph before it, and every glyph of it
+    size_t end = position + inserted.size();
+    for (size_t i = position > 0 ? position - 1 : 0; i < end; ++i)
+        Rekern(extractor, i);
+    return true;
+}
+
+void EditableText::Erase(GlyphExtractor &extractor, const string &font, int patchSize,
+                         size_t position, size_t count)
+{
+    Prepare(extractor, font, patchSize);
+    if (position >= m_glyphs.Size())
+        return;
+    if (count > m_glyphs.Size() - position) count = m_glyphs.Size() - position;
+
+    for (size_t i = position; i < position + count; ++i)
+        m_freeSlots.push_back(m_glyphs[i].slot);
+    m_glyphs.Erase(position, count);
+
+    if (position > 0)
+        Rekern(extractor, position - 1);
+}
+
+// --------------------------------------------------------------------------
+
+string EditableText::Text() const
+{
+    string text;
+    for (size_t i = 0; i < m_glyphs.Size(); ++i)
+        EncodeUtf8(m_glyphs[i].character, text);
+    return text;
+}
+
+float EditableText::CaretX(size_t position) const
+{
+    float x = 0.0f;
+    for (size_t i = 0; i < position && i < m_glyphs.Size(); ++i)
+        x += m_glyphs[i].advance + m_glyphs[i].kerning;
+    return x;
+}
+
+void EditableText::Draw(GLuint program, const vec2 &origin) const
+{
+    GLint offsetLocation = glGetUniformLocation(program, "offset");
+    glBindVertexArray(m_vertexArray);
+
+    float x = 0.0f;
+    for (size_t i = 0; i < m_glyphs.Size(); ++i)
+    {
+        const Glyph &glyph = m_glyphs[i];
+        if (glyph.count > 0) {
+            vec2 offset = origin + vec2(x * m_scale, 0.0f);
+            glUniform2f(offsetLocation, offset.x, offset.y);
+            glDrawArrays(GL_PATCHES, glyph.slot * m_slotVertices, glyph.count);
+        }
+        x += glyph.advance + glyph.kerning;
+    }
+
+    glUniform2f(offsetLocation, 0.0f, 0.0f);
+    glBindVertexArray(0);
+}
+
+// --------------------------------------------------------------------------
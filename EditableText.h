@@ -0,0 +1,124 @@
+// ==========================================================================
+// Editable Text
+//
+// A line of text that can be edited in place and drawn without rebuilding
+// it. The glyphs are kept in a gap buffer, each with its own slot: a fixed
+// range of one vertex buffer holding its patches, built at the origin.
+// Inserting characters extracts and uploads only the new glyphs, into free
+// slots with glBufferSubData; erasing just frees slots. Only the kerning of
+// the pairs around the edit is looked up again. Each glyph is placed when
+// it is drawn, by the vertex shader's offset uniform, from the running sum
+// of advances, so the glyphs after an edit move over without being touched.
+//
+// An OpenGL context must be current whenever the text is edited, drawn or
+// destroyed.
+// ==========================================================================
+#ifndef EDITABLETEXT_H
+#define EDITABLETEXT_H
+
+#include <string>
+#include <vector>
+
+#include <glad/include/glad/glad.h>
+#include <glm-0.9.8.2/glm/glm.hpp>
+
+#include "GapBuffer.h"
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+
+class EditableText
+{
+    // a glyph of the text: its character, the slot holding its patches and
+    // how many vertices they take, its advance, and the kerning between it
+    // and the next glyph, in EM units
+    struct Glyph
+    {
+        int     character;
+        unsigned int slot;
+        GLsizei count;
+        float   advance, kerning;
+    };
+
+    GapBuffer<Glyph> m_glyphs;
+
+    GLuint m_vertexBuffer, m_colourBuffer, m_vertexArray;
+
+    // slots in the buffers, and the ones not holding a glyph
+    unsigned int m_slotCount, m_slotVertices;
+    std::vector<unsigned int> m_freeSlots;
+
+    // what the slots were built with
+    std::string m_font;
+    int   m_patchSize;
+    float m_scale;
+    glm::vec3 m_colour;
+
+    // patch data for the glyph being uploaded
+    std::vector<glm::vec2> m_vertices;
+    std::vector<glm::vec3> m_colours;
+
+    unsigned long m_uploads;
+    size_t m_bytesUploaded;
+
+    // takes a free slot, doubling the buffers if there is none; returns
+    // false if the buffers could not grow. A failed grow keeps the old
+    // buffers and slots as they were.
+    bool AllocateSlot(unsigned int &slot);
+    bool GrowBuffers(unsigned int slotCount);
+
+    // builds a glyph's patches and writes them into its slot
+    void Upload(GlyphExtractor &extractor, Glyph &glyph);
+
+    // looks up the kerning between the glyph at position and the next one
+    void Rekern(GlyphExtractor &extractor, size_t position);
+
+    // switches to the given font and patch size, rebuilding every glyph if
+    // they differ from what the slots hold
+    void Prepare(GlyphExtractor &extractor, const std::string &font, int patchSize);
+
+    EditableText(const EditableText &);
+    EditableText &operator=(const EditableText &);
+
+public:
+    // scale takes EM units to clip coordinates; slotVertices is the most
+    // patch vertices one glyph may have
+    EditableText(float scale, unsigned int slotVertices = 1024);
+    ~EditableText();
+
+    // creates the buffers with room for the given number of glyphs; they
+    // grow as needed. Returns false on an OpenGL error.
+    bool Initialize(unsigned int slots = 64);
+    void Destroy();
+
+    // inserts UTF-8 text before the character at position, or erases count
+    // characters from position, drawing in the given font and patch size.
+    // Insert returns false, inserting nothing, if there is no room for the
+    // text's glyphs.
+    bool Insert(GlyphExtractor &extractor, const std::string &font, int patchSize,
+                size_t position, const std::string &text);
+    void Erase(GlyphExtractor &extractor, const std::string &font, int patchSize,
+               size_t position, size_t count);
+
+    // rebuilds the glyphs if the font or patch size has changed
+    void Update(GlyphExtractor &extractor, const std::string &font, int patchSize)
+    { Prepare(extractor, font, patchSize); }
+
+    // number of characters, the text as UTF-8, and the pen position before
+    // the character at position (the caret position), in EM units
+    size_t Length() const           { return m_glyphs.Size(); }
+    std::string Text() const;
+    float CaretX(size_t position) const;
+
+    // draws the text with its pen starting at origin, in clip coordinates
+    void Draw(GLuint program, const glm::vec2 &origin) const;
+
+    // statistics
+    unsigned long GlyphsUploaded() const    { return m_uploads; }
+    size_t BytesUploaded() const            { return m_bytesUploaded; }
+    size_t BufferBytes() const
+    { return size_t(m_slotCount) * m_slotVertices * (sizeof(glm::vec2) + sizeof(glm::vec3)); }
+};
+
+// --------------------------------------------------------------------------
+#endif // EDITABLETEXT_H
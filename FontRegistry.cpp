@@ -0,0 +1,101 @@
+// ==========================================================================
+// Font Face Registry
+//
+// This module keeps track of the FreeType faces opened by a GlyphExtractor.
+// Each font file is opened once; callers receive shared FontHandles to the
+// face, and the face is closed when the registry lets go of it and the last
+// handle is dropped. Every file is also given a small integer id that stays
+// the same for the lifetime of the registry, for use as a cache key.
+//
+// Faces can optionally be opened over a shared read-only mapping of the font
+// file (see MappedFile.h) rather than having FreeType read the file itself.
+// ==========================================================================
+
+#include "FontRegistry.h"
+#include <iostream>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+FontFace::~FontFace()
+{
+    if (face) FT_Done_Face(face);
+}
+
+// --------------------------------------------------------------------------
+
+FontRegistry::FontRegistry(FT_Library library)
+    : m_library(library), m_memoryMapped(false)
+{}
+
+FontRegistry::~FontRegistry()
+{
+    Clear();
+}
+
+// --------------------------------------------------------------------------
+
+FontHandle FontRegistry::Open(const string &filename)
+{
+    map<string, FontHandle>::iterator it = m_faces.find(filename);
+    if (it != m_faces.end())
+        return it->second;
+
+    FT_Face face = 0;
+    FT_Error error;
+    MappedFileHandle mapping;
+
+    if (m_memoryMapped)
+    {
+        mapping = MappedFile::Open(filename);
+        if (!mapping)
+            return FontHandle();
+        error = FT_New_Memory_Face(m_library, mapping->Data(),
+                                   FT_Long(mapping->Size()), 0, &face);
+    }
+    else
+        error = FT_New_Face(m_library, filename.c_str(), 0, &face);
+
+    if (error == FT_Err_Unknown_File_Format) {
+        cout << "Freetype ERROR: unsupported file format in " << filename << endl;
+        return FontHandle();
+    }
+    else if (error) {
+        cout << "FreeType ERROR: unknown error occurred." << endl;
+        return FontHandle();
+    }
+
+    FontHandle handle = make_shared<FontFace>(face, filename, FaceId(filename), mapping);
+    handle->cmap.Build(face);
+    handle->kerning.Build(face);
+    m_faces[filename] = handle;
+    return handle;
+}
+
+int FontRegistry::FaceId(const string &filename)
+{
+    map<string, int>::iterator it = m_ids.find(filename);
+    if (it == m_ids.end())
+        it = m_ids.insert(make_pair(filename, int(m_ids.size()))).first;
+    return it->second;
+}
+
+// --------------------------------------------------------------------------
+
+void FontRegistry::ReleaseUnused()
+{
+    map<string, FontHandle>::iterator it = m_faces.begin();
+    while (it != m_faces.end())
+    {
+        if (it->second.use_count() == 1) m_faces.erase(it++);
+        else ++it;
+    }
+}
+
+void FontRegistry::Clear()
+{
+    m_faces.clear();
+}
+
+// --------------------------------------------------------------------------
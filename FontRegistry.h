@@ -0,0 +1,107 @@
+// ==========================================================================
+// Font Face Registry
+//
+// This module keeps track of the FreeType faces opened by a GlyphExtractor.
+// Each font file is opened once; callers receive shared FontHandles to the
+// face, and the face is closed when the registry lets go of it and the last
+// handle is dropped. Every file is also given a small integer id that stays
+// the same for the lifetime of the registry, for use as a cache key.
+//
+// Faces can optionally be opened over a shared read-only mapping of the font
+// file (see MappedFile.h) rather than having FreeType read the file itself.
+// ==========================================================================
+#ifndef FONTREGISTRY_H
+#define FONTREGISTRY_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "CharacterMap.h"
+#include "KerningTable.h"
+#include "MappedFile.h"
+
+// --------------------------------------------------------------------------
+// An opened face and the file it was loaded from. The face is released with
+// FT_Done_Face when this object is destroyed, before its mapping (if any).
+
+struct FontFace
+{
+    FT_Face     face;
+    std::string filename;
+    int         id;
+
+    // file data the face was opened over, empty if FreeType reads the file
+    MappedFileHandle mapping;
+
+    // code point to glyph index table, built when the face is opened
+    CharacterMap cmap;
+
+    // kerning pairs by glyph index, read when the face is opened
+    KerningTable kerning;
+
+    // advance widths in EM units by glyph index, filled in as they are asked
+    // for; negative entries have not been looked up yet
+    std::vector<float> advances;
+
+    FontFace(FT_Face f, const std::string &name, int i,
+             const MappedFileHandle &m = MappedFileHandle())
+        : face(f), filename(name), id(i), mapping(m)
+    {}
+    ~FontFace();
+
+private:
+    FontFace(const FontFace &);
+    FontFace &operator=(const FontFace &);
+};
+
+typedef std::shared_ptr<FontFace> FontHandle;
+
+// --------------------------------------------------------------------------
+
+class FontRegistry
+{
+    FT_Library  m_library;
+
+    // faces that are currently open, and ids handed out for each file name
+    std::map<std::string, FontHandle> m_faces;
+    std::map<std::string, int> m_ids;
+
+    // whether new faces are opened over memory-mapped files
+    bool        m_memoryMapped;
+
+public:
+    FontRegistry(FT_Library library);
+    ~FontRegistry();
+
+    // returns a handle to the face for the given file, opening it only if
+    // it is not already open; returns an empty handle on failure
+    FontHandle Open(const std::string &filename);
+
+    // returns the id for the given file name, assigning one if needed
+    int FaceId(const std::string &filename);
+
+    // choose how faces opened from now on get their data: through a shared
+    // read-only mapping of the file (true), or FreeType's own file I/O
+    void SetMemoryMapped(bool enable)   { m_memoryMapped = enable; }
+    bool MemoryMapped() const           { return m_memoryMapped; }
+
+    // closes faces that are not referenced by any handle outside the registry
+    void ReleaseUnused();
+
+    // drops the registry's references to all faces
+    void Clear();
+
+    size_t OpenFaceCount() const    { return m_faces.size(); }
+
+private:
+    FontRegistry(const FontRegistry &);
+    FontRegistry &operator=(const FontRegistry &);
+};
+
+// --------------------------------------------------------------------------
+#endif // FONTREGISTRY_H
@@ -0,0 +1,90 @@
+// ==========================================================================
+// Gap Buffer
+//
+// A sequence stored in one array with a gap of unused elements at the
+// place it was last edited. Inserting or erasing there only fills or widens
+// the gap; moving the edit point moves the elements between the old and new
+// places across the gap. Typing and deleting at a caret therefore costs
+// time in proportion to the edit, not to the length of the sequence. Meant
+// for trivially copyable elements.
+// ==========================================================================
+#ifndef GAPBUFFER_H
+#define GAPBUFFER_H
+
+#include <algorithm>
+#include <vector>
+
+// --------------------------------------------------------------------------
+
+template <class T>
+class GapBuffer
+{
+    // elements [0, m_gapBegin) and [m_gapEnd, size) of the storage are in use
+    std::vector<T> m_storage;
+    size_t m_gapBegin, m_gapEnd;
+
+    // moves the gap so it starts at position, and makes it at least count long
+    void MoveGap(size_t position, size_t count)
+    {
+        if (m_gapEnd - m_gapBegin < count)
+        {
+            size_t after = m_storage.size() - m_gapEnd;
+            size_t grown = std::max(m_storage.size() * 2, Size() + count + 16);
+            m_storage.resize(grown);
+            std::copy_backward(m_storage.begin() + m_gapEnd,
+                               m_storage.begin() + m_gapEnd + after, m_storage.end());
+            m_gapEnd = grown - after;
+        }
+
+        if (position < m_gapBegin) {
+            size_t moved = m_gapBegin - position;
+            std::copy_backward(m_storage.begin() + position, m_storage.begin() + m_gapBegin,
+                               m_storage.begin() + m_gapEnd);
+            m_gapBegin -= moved;
+            m_gapEnd -= moved;
+        }
+        else if (position > m_gapBegin) {
+            size_t moved = position - m_gapBegin;
+            std::copy(m_storage.begin() + m_gapEnd, m_storage.begin() + m_gapEnd + moved,
+                      m_storage.begin() + m_gapBegin);
+            m_gapBegin += moved;
+            m_gapEnd += moved;
+        }
+    }
+
+public:
+    GapBuffer() : m_gapBegin(0), m_gapEnd(0)
+    {}
+
+    size_t Size() const     { return m_storage.size() - (m_gapEnd - m_gapBegin); }
+    bool Empty() const      { return Size() == 0; }
+
+    T &operator[](size_t i)
+    { return m_storage[i < m_gapBegin ? i : i + (m_gapEnd - m_gapBegin)]; }
+    const T &operator[](size_t i) const
+    { return m_storage[i < m_gapBegin ? i : i + (m_gapEnd - m_gapBegin)]; }
+
+    // inserts count elements before position
+    void Insert(size_t position, const T *elements, size_t count)
+    {
+        MoveGap(position, count);
+        std::copy(elements, elements + count, m_storage.begin() + m_gapBegin);
+        m_gapBegin += count;
+    }
+
+    // erases count elements starting at position
+    void Erase(size_t position, size_t count)
+    {
+        MoveGap(position, 0);
+        m_gapEnd += count;
+    }
+
+    void Clear()
+    {
+        m_storage.clear();
+        m_gapBegin = m_gapEnd = 0;
+    }
+};
+
+// --------------------------------------------------------------------------
+#endif // GAPBUFFER_H
@@ -0,0 +1,348 @@
+// ==========================================================================
+// Precompiled Glyph Cache Files
+//
+// A glyph cache file holds outlines already extracted from one font file,
+// so a program can draw them without opening the font with FreeType. Files
+// are written offline (see glyphcache.cpp) and mapped read-only at run
+// time; outlines are served as MyOutline views pointing straight into the
+// mapping, with nothing copied or decoded.
+// ==========================================================================
+
+#include "GlyphCacheFile.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <sys/stat.h>
+
+using namespace std;
+
+static const char MAGIC[8] = { 'S', 'F', 'G', 'L', 'Y', 'P', 'H', 'S' };
+
+// sections start on this boundary
+static const size_t ALIGNMENT = 16;
+
+static size_t Align(size_t offset)
+{
+    return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+// size and modification time of a file, which change whenever it is
+// replaced or rewritten
+static bool FileStamp(const string &filename, unsigned long long &size, long long &modified)
+{
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0)
+        return false;
+    size = info.st_size;
+    modified = info.st_mtime;
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+GlyphCacheFile::GlyphCacheFile(const MappedFileHandle &mapping)
+    : m_mapping(mapping),
+      m_header(reinterpret_cast<const GlyphCacheHeader *>(mapping->Data())),
+      m_records(0), m_segments(0), m_contours(0), m_kerning(0)
+{}
+
+shared_ptr<GlyphCacheFile> GlyphCacheFile::Open(const string &filename)
+{
+    shared_ptr<GlyphCacheFile> file;
+
+    MappedFileHandle mapping = MappedFile::Open(filename);
+    if (!mapping)
+        return file;
+
+    file.reset(new GlyphCacheFile(mapping));
+    if (!file->Validate()) {
+        cout << "GlyphCacheFile ERROR: " << filename
+             << " is not a glyph cache file for this build" << endl;
+        file.reset();
+        return file;
+    }
+
+    const unsigned char *data = mapping->Data();
+    const GlyphCacheHeader &header = *file->m_header;
+    file->m_records = reinterpret_cast<const GlyphCacheRecord *>(data + header.recordOffset);
+    file->m_segments = reinterpret_cast<const MySegment *>(data + header.segmentOffset);
+    file->m_contours = reinterpret_cast<const MyContourSpan *>(data + header.contourOffset);
+    file->m_kerning = reinterpret_cast<const GlyphCacheKerning *>(data + header.kerningOffset);
+    file->m_fontFilename.assign(reinterpret_cast<const char *>(data + header.nameOffset),
+                                header.nameLength);
+
+    if (!file->MatchesFont()) {
+        cout << "GlyphCacheFile ERROR: " << filename << " is out of date; "
+             << file->m_fontFilename << " has changed since it was written" << endl;
+        file.reset();
+    }
+    return file;
+}
+
+bool GlyphCacheFile::MatchesFont() const
+{
+    // a font that is not there can't be checked, and the cache file is all
+    // there is to draw it from
+    unsigned long long size;
+    long long modified;
+    if (!FileStamp(m_fontFilename, size, modified))
+        return true;
+    return size == m_header->fontSize && modified == m_header->fontModified;
+}
+
+bool GlyphCacheFile::Validate() const
+{
+    size_t size = m_mapping->Size();
+    if (size < sizeof(GlyphCacheHeader))
+        return false;
+
+    const GlyphCacheHeader &h = *m_header;
+    if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION ||
+        h.segmentSize != sizeof(MySegment))
+        return false;
+
+    // every section must lie inside the file and be aligned for its type
+    size_t offsets[] = { h.recordOffset, h.segmentOffset, h.contourOffset, h.kerningOffset };
+    size_t sizes[] = { size_t(h.glyphCount) * sizeof(GlyphCacheRecord),
+                       size_t(h.segmentCount) * sizeof(MySegment),
+                       size_t(h.contourCount) * sizeof(MyContourSpan),
+                       size_t(h.kerningCount) * sizeof(GlyphCacheKerning) };
+    for (int i = 0; i < 4; ++i) {
+        if (offsets[i] % ALIGNMENT || offsets[i] > size || sizes[i] > size - offsets[i])
+            return false;
+    }
+    if (h.nameOffset > size || h.nameLength > size - h.nameOffset)
+        return false;
+
+    // and every glyph's segments and contours inside their sections
+    const unsigned char *data = m_mapping->Data();
+    const GlyphCacheRecord *records =
+        reinterpret_cast<const GlyphCacheRecord *>(data + h.recordOffset);
+    const MyContourSpan *contours =
+        reinterpret_cast<const MyContourSpan *>(data + h.contourOffset);
+    const MySegment *segments =
+        reinterpret_cast<const MySegment *>(data + h.segmentOffset);
+
+    for (unsigned int g = 0; g < h.glyphCount; ++g)
+    {
+        const GlyphCacheRecord &r = records[g];
+        if (g > 0 && records[g - 1].character >= r.character)
+            return false;
+        if (r.segmentBegin > h.segmentCount || r.segmentCount > h.segmentCount - r.segmentBegin ||
+            r.contourBegin > h.contourCount || r.contourCount > h.contourCount - r.contourBegin)
+            return false;
+
+        for (unsigned int c = 0; c < r.contourCount; ++c) {
+            const MyContourSpan &span = contours[r.contourBegin + c];
+            if (span.begin > r.segmentCount || span.count > r.segmentCount - span.begin)
+                return false;
+        }
+
+        // segments are drawn by reading control points up to their degree
+        for (unsigned int s = r.segmentBegin; s < r.segmentBegin + r.segmentCount; ++s) {
+            if (segments[s].degree < 1 || segments[s].degree > 3)
+                return false;
+        }
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool GlyphCacheFile::Write(const string &filename, GlyphExtractor &extractor,
+                           const string &fontFilename, const vector<int> &characters)
+{
+    GlyphCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    if (!FileStamp(fontFilename, header.fontSize, header.fontModified)) {
+        cout << "GlyphCacheFile ERROR: could not read " << fontFilename << endl;
+        return false;
+    }
+
+    vector<int> sorted(characters);
+    sort(sorted.begin(), sorted.end());
+    sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+
+    vector<GlyphCacheRecord> records;
+    vector<MySegment> segments;
+    vector<MyContourSpan> contours;
+
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        int character = sorted[i];
+        MyGlyphMetrics metrics;
+        if (!extractor.HasGlyph(character) || !extractor.GetGlyphMetrics(character, metrics))
+            continue;
+
+        MyGlyph glyph = extractor.ExtractGlyph(character);
+
+        GlyphCacheRecord record;
+        record.character = character;
+        record.advance = glyph.advance;
+        record.xMin = metrics.xMin;
+        record.yMin = metrics.yMin;
+        record.xMax = metrics.xMax;
+        record.yMax = metrics.yMax;
+        record.segmentBegin = segments.size();
+        record.contourBegin = contours.size();
+
+        for (size_t c = 0; c < glyph.contours.size(); ++c)
+        {
+            MyContourSpan span;
+            span.begin = segments.size() - record.segmentBegin;
+            span.count = glyph.contours[c].size();
+            contours.push_back(span);
+
+            // unused control points are zeroed so files are reproducible
+            for (size_t s = 0; s < glyph.contours[c].size(); ++s)
+            {
+                const MySegment &source = glyph.contours[c][s];
+                MySegment segment(source.degree);
+                fill(segment.x, segment.x + 4, 0.0f);
+                fill(segment.y, segment.y + 4, 0.0f);
+                copy(source.x, source.x + source.degree + 1, segment.x);
+                copy(source.y, source.y + source.degree + 1, segment.y);
+                segments.push_back(segment);
+            }
+        }
+
+        record.segmentCount = segments.size() - record.segmentBegin;
+        record.contourCount = contours.size() - record.contourBegin;
+        records.push_back(record);
+    }
+
+    // the font's kerning pairs between stored characters, sorted by left
+    // then right character for lookup
+    vector<int> stored(records.size());
+    for (size_t i = 0; i < records.size(); ++i)
+        stored[i] = records[i].character;
+    vector<MyKerningPair> pairs;
+    extractor.GetKerningPairs(stored, pairs);
+
+    vector<GlyphCacheKerning> kerning(pairs.size());
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        kerning[i].left = pairs[i].left;
+        kerning[i].right = pairs[i].right;
+        kerning[i].kerning = pairs[i].kerning;
+    }
+    sort(kerning.begin(), kerning.end(),
+        [](const GlyphCacheKerning &a, const GlyphCacheKerning &b) {
+            return a.left < b.left || (a.left == b.left && a.right < b.right);
+        });
+
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.segmentSize = sizeof(MySegment);
+    header.glyphCount = records.size();
+    header.segmentCount = segments.size();
+    header.contourCount = contours.size();
+    header.nameLength = fontFilename.size();
+    header.kerningCount = kerning.size();
+
+    header.recordOffset = Align(sizeof(header));
+    header.segmentOffset = Align(header.recordOffset + records.size() * sizeof(GlyphCacheRecord));
+    header.contourOffset = Align(header.segmentOffset + segments.size() * sizeof(MySegment));
+    header.kerningOffset = Align(header.contourOffset + contours.size() * sizeof(MyContourSpan));
+    header.nameOffset = header.kerningOffset + kerning.size() * sizeof(GlyphCacheKerning);
+
+    MyFaceMetrics face = extractor.GetFaceMetrics();
+    header.ascent = face.ascent;
+    header.descent = face.descent;
+    header.lineGap = face.lineGap;
+
+    // assemble the whole file in memory, then write it in one go
+    vector<char> bytes(header.nameOffset + header.nameLength, 0);
+    memcpy(&bytes[0], &header, sizeof(header));
+    if (!records.empty())
+        memcpy(&bytes[header.recordOffset], &records[0], records.size() * sizeof(GlyphCacheRecord));
+    if (!segments.empty())
+        memcpy(&bytes[header.segmentOffset], &segments[0], segments.size() * sizeof(MySegment));
+    if (!contours.empty())
+        memcpy(&bytes[header.contourOffset], &contours[0], contours.size() * sizeof(MyContourSpan));
+    if (!kerning.empty())
+        memcpy(&bytes[header.kerningOffset], &kerning[0], kerning.size() * sizeof(GlyphCacheKerning));
+    copy(fontFilename.begin(), fontFilename.end(), bytes.begin() + header.nameOffset);
+
+    ofstream out(filename.c_str(), ios::binary);
+    out.write(&bytes[0], bytes.size());
+    if (!out) {
+        cout << "GlyphCacheFile ERROR: could not write " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+const GlyphCacheRecord *GlyphCacheFile::Find(int character) const
+{
+    const GlyphCacheRecord *end = m_records + m_header->glyphCount;
+    const GlyphCacheRecord *r = lower_bound(m_records, end, character,
+        [](const GlyphCacheRecord &record, int c) { return record.character < c; });
+    return r != end && r->character == character ? r : 0;
+}
+
+bool GlyphCacheFile::Outline(int character, MyOutline &outline) const
+{
+    const GlyphCacheRecord *r = Find(character);
+    if (!r) return false;
+
+    outline.advance = r->advance;
+    outline.segments = m_segments + r->segmentBegin;
+    outline.segmentCount = r->segmentCount;
+    outline.contours = m_contours + r->contourBegin;
+    outline.contourCount = r->contourCount;
+    return true;
+}
+
+bool GlyphCacheFile::Glyph(int character, MyGlyph &glyph) const
+{
+    MyOutline outline;
+    if (!Outline(character, outline)) return false;
+
+    glyph.advance = outline.advance;
+    glyph.contours.resize(outline.contourCount);
+    for (unsigned int c = 0; c < outline.contourCount; ++c)
+        glyph.contours[c].assign(outline.ContourBegin(c), outline.ContourEnd(c));
+    return true;
+}
+
+bool GlyphCacheFile::Metrics(int character, MyGlyphMetrics &metrics) const
+{
+    const GlyphCacheRecord *r = Find(character);
+    if (!r) return false;
+
+    metrics.advance = r->advance;
+    metrics.xMin = r->xMin;
+    metrics.yMin = r->yMin;
+    metrics.xMax = r->xMax;
+    metrics.yMax = r->yMax;
+    return true;
+}
+
+bool GlyphCacheFile::Kerning(int left, int right, float &kerning) const
+{
+    if (!Find(left) || !Find(right))
+        return false;
+
+    const GlyphCacheKerning *end = m_kerning + m_header->kerningCount;
+    const GlyphCacheKerning *k = lower_bound(m_kerning, end, make_pair(left, right),
+        [](const GlyphCacheKerning &pair, const std::pair<int, int> &key) {
+            return pair.left < key.first || (pair.left == key.first && pair.right < key.second);
+        });
+    kerning = k != end && k->left == left && k->right == right ? k->kerning : 0.0f;
+    return true;
+}
+
+MyFaceMetrics GlyphCacheFile::FaceMetrics() const
+{
+    MyFaceMetrics metrics;
+    metrics.ascent = m_header->ascent;
+    metrics.descent = m_header->descent;
+    metrics.lineGap = m_header->lineGap;
+    return metrics;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,132 @@
+// ==========================================================================
+// Precompiled Glyph Cache Files
+//
+// A glyph cache file holds outlines already extracted from one font file,
+// so a program can draw them without opening the font with FreeType. Files
+// are written offline (see glyphcache.cpp) and mapped read-only at run
+// time; outlines are served as MyOutline views pointing straight into the
+// mapping, with nothing copied or decoded.
+//
+// Layout, in native byte order, each section 16-byte aligned:
+//  - GlyphCacheHeader: magic, version, counts and section offsets, the face
+//    metrics, and the size and modification time of the font file the
+//    glyphs came from
+//  - GlyphCacheRecord array, sorted by code point, used as the index
+//  - MySegment array holding the segments of every glyph
+//  - MyContourSpan array; spans are relative to their glyph's first segment
+//  - GlyphCacheKerning array of the non-zero kerning pairs among the stored
+//    characters, sorted by left then right character
+//  - the font file name
+// Segments are stored as in memory, so a file is only accepted by builds
+// with the same MySegment layout; the header records its size to check.
+// A file is also turned down once its font file has been replaced, so the
+// font is opened with FreeType instead of drawing stale outlines.
+// ==========================================================================
+#ifndef GLYPHCACHEFILE_H
+#define GLYPHCACHEFILE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GlyphExtractor.h"
+#include "MappedFile.h"
+
+// --------------------------------------------------------------------------
+
+struct GlyphCacheHeader
+{
+    char         magic[8];          // "SFGLYPHS"
+    unsigned int version;
+    unsigned int segmentSize;       // sizeof(MySegment) of the writer
+
+    unsigned int glyphCount, segmentCount, contourCount, nameLength;
+    unsigned int recordOffset, segmentOffset, contourOffset, nameOffset;
+
+    float ascent, descent, lineGap;
+    unsigned int kerningCount, kerningOffset;
+
+    // the font file as it was when the glyphs were extracted
+    unsigned long long fontSize;
+    long long          fontModified;
+};
+
+struct GlyphCacheRecord
+{
+    int          character;
+    float        advance;
+    float        xMin, yMin, xMax, yMax;
+    unsigned int segmentBegin, segmentCount;
+    unsigned int contourBegin, contourCount;
+};
+
+struct GlyphCacheKerning
+{
+    int   left, right;
+    float kerning;
+};
+
+// --------------------------------------------------------------------------
+
+class GlyphCacheFile
+{
+    MappedFileHandle m_mapping;
+
+    // sections of the mapped file
+    const GlyphCacheHeader *m_header;
+    const GlyphCacheRecord *m_records;
+    const MySegment        *m_segments;
+    const MyContourSpan    *m_contours;
+    const GlyphCacheKerning *m_kerning;
+    std::string             m_fontFilename;
+
+    GlyphCacheFile(const MappedFileHandle &mapping);
+
+    // checks that the header and every record stay within the file, and
+    // that every segment has a degree the renderer can draw
+    bool Validate() const;
+
+    // checks that the font file is still the one the glyphs came from
+    bool MatchesFont() const;
+
+    GlyphCacheFile(const GlyphCacheFile &);
+    GlyphCacheFile &operator=(const GlyphCacheFile &);
+
+public:
+    static const unsigned int VERSION = 3;
+
+    // maps and checks a cache file; returns an empty handle on failure, or
+    // if the font file it was built from has changed since
+    static std::shared_ptr<GlyphCacheFile> Open(const std::string &filename);
+
+    // extracts the given characters from the extractor's current font and
+    // writes them to a cache file; characters the font has no glyph for are
+    // left out. fontFilename is recorded so the runtime can tell which font
+    // the file stands in for.
+    static bool Write(const std::string &filename, GlyphExtractor &extractor,
+                      const std::string &fontFilename,
+                      const std::vector<int> &characters);
+
+    // font file the glyphs were extracted from
+    const std::string &FontFilename() const     { return m_fontFilename; }
+
+    // returns the record for a character, or null if it is not in the file
+    const GlyphCacheRecord *Find(int character) const;
+
+    // lookups by character; these return false for characters not stored
+    bool Outline(int character, MyOutline &outline) const;
+    bool Glyph(int character, MyGlyph &glyph) const;
+    bool Metrics(int character, MyGlyphMetrics &metrics) const;
+
+    // kerning between two characters in EM units; false unless both are in
+    // the file, as pairs with other characters were not recorded
+    bool Kerning(int left, int right, float &kerning) const;
+
+    MyFaceMetrics FaceMetrics() const;
+    unsigned int GlyphCount() const     { return m_header->glyphCount; }
+};
+
+typedef std::shared_ptr<GlyphCacheFile> GlyphCacheHandle;
+
+// --------------------------------------------------------------------------
+#endif // GLYPHCACHEFILE_H
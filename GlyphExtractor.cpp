@@ -17,8 +17,18 @@
 // ==========================================================================
 
 #include "GlyphExtractor.h"
+#include "CompactOutline.h"
+#include "GlyphCacheFile.h"
+#include "OutlineDecoder.h"
+#include "ThreadPool.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 
+#include FT_ADVANCES_H
+#include FT_MODULE_H
+
 // set this true to print information about the font loaded and glyphs extracted
 #define DEBUG_PRINT 0
 
@@ -26,36 +36,231 @@ using namespace std;
 
 // --------------------------------------------------------------------------
 
-GlyphExtractor::GlyphExtractor()
-    : m_face(0)
+// One font being prewarmed. A worker fills in the glyphs and then sets
+// ready; the thread using the extractor takes them in once it sees that.
+struct PrewarmFont
+{
+    string filename;
+    int id;
+    vector<MyGlyph> glyphs;
+    vector<unsigned char> mapped;
+    atomic<bool> ready;
+    bool opened, collected;
+
+    PrewarmFont(const string &name, int i)
+        : filename(name), id(i), ready(false), opened(false), collected(false)
+    {}
+};
+
+// Everything shared with the prewarm workers. The pool is declared last so
+// it is destroyed, finishing its tasks, before the data they use.
+struct GlyphExtractor::PrewarmState
+{
+    vector<int> characters;
+    vector< shared_ptr<PrewarmFont> > fonts;
+    atomic<unsigned int> done;
+    unsigned int total;
+    float tolerance;
+    ThreadPool pool;
+
+    PrewarmState(unsigned int threads) : done(0), total(0), tolerance(0), pool(threads)
+    {}
+};
+
+// --------------------------------------------------------------------------
+
+GlyphExtractor::GlyphExtractor(bool pooledMemory)
+    : m_allocator(pooledMemory ? new PoolAllocator : 0),
+      m_library(CreateLibrary(m_allocator)), m_face(0), m_registry(m_library),
+      m_fontId(-1), m_prewarm(0),
+      m_compact(new CompactOutlineStore), m_compactCache(false),
+      m_batchConversion(true), m_quadraticTolerance(0),
+      m_pool(0), m_cacheHits(0), m_cacheMisses(0)
+{}
+
+GlyphExtractor::~GlyphExtractor()
+{
+    delete m_prewarm;
+    delete m_pool;
+    delete m_compact;
+
+    // faces must be closed before the library that owns them
+    m_font.reset();
+    m_fallbacks.clear();
+    m_registry.Clear();
+
+    // a library on our own allocator is released without freeing its
+    // memory object, which belongs to the allocator
+    if (m_library && m_allocator) FT_Done_Library(m_library);
+    else if (m_library) FT_Done_FreeType(m_library);
+    delete m_allocator;
+}
+
+FT_Library GlyphExtractor::CreateLibrary(PoolAllocator *allocator)
 {
     // initialize freetype library
-    FT_Error error = FT_Init_FreeType(&m_library);
+    FT_Library library = 0;
+    FT_Error error;
+    if (allocator) {
+        error = FT_New_Library(allocator->Memory(), &library);
+        if (!error) {
+            FT_Add_Default_Modules(library);
+#if FREETYPE_MAJOR > 2 || FREETYPE_MINOR > 8 || (FREETYPE_MINOR == 8 && FREETYPE_PATCH >= 1)
+            FT_Set_Default_Properties(library);
+#endif
+        }
+    }
+    else
+        error = FT_Init_FreeType(&library);
+
     if (error) {
         cout << "ERROR: FreeType failed to initialize!" << endl;
+        return 0;
     }
+    return library;
 }
 
 // --------------------------------------------------------------------------
 
 bool GlyphExtractor::LoadFontFile(const string &filename)
 {
-    FT_Error error = FT_New_Face(m_library, filename.c_str(), 0, &m_face);
+    // nothing to do if this font is already the current one
+    if (!m_fontName.empty() && m_fontName == filename)
+        return true;
+
+    // memory for the new face is charged to it, as is everything loaded
+    // while it is the current font
+    int id = m_registry.FaceId(filename);
+    if (m_allocator) m_allocator->SetOwner(id);
 
-    if (error == FT_Err_Unknown_File_Format) {
-        cout << "Freetype ERROR: unsupported file format in " << filename << endl;
+    // take in any fonts prewarmed in the background since the last switch
+    if (m_prewarm) CollectPrewarmedFonts();
+
+    // a font with a glyph cache file, or one that has been prewarmed, is
+    // not opened until a glyph it does not have yet is needed
+    map<string, GlyphCacheHandle>::iterator file = m_cacheFiles.find(filename);
+    if (file != m_cacheFiles.end() || m_prewarmedFonts.count(filename))
+    {
+        m_fontName = filename;
+        m_fontId = id;
+        m_cacheFile = file != m_cacheFiles.end() ? file->second : GlyphCacheHandle();
+        m_font.reset();
+        m_face = 0;
+        return true;
+    }
+
+    FontHandle font = m_registry.Open(filename);
+    if (!font) {
+        if (m_allocator) m_allocator->SetOwner(m_fontId);
         return false;
     }
-    else if (error) {
-        cout << "FreeType ERROR: unknown error occurred." << endl;
+
+    m_fontName = filename;
+    m_fontId = id;
+    m_cacheFile.reset();
+    m_font = font;
+    m_face = font->face;
+
+    if (DEBUG_PRINT) PrintFontInformation();
+
+    return true;
+}
+
+bool GlyphExtractor::OpenFace() const
+{
+    if (m_face)
+        return true;
+
+    if (m_fontName.empty()) {
+        cout << "GlyphExtractor ERROR: No font loaded!" << endl;
         return false;
     }
 
+    FontHandle font = m_registry.Open(m_fontName);
+    if (!font)
+        return false;
+
+    m_font = font;
+    m_face = font->face;
+
     if (DEBUG_PRINT) PrintFontInformation();
 
     return true;
 }
 
+bool GlyphExtractor::UseGlyphCacheFile(const string &filename)
+{
+    GlyphCacheHandle file = GlyphCacheFile::Open(filename);
+    if (!file)
+        return false;
+
+    m_cacheFiles[file->FontFilename()] = file;
+    if (file->FontFilename() == m_fontName)
+        m_cacheFile = file;
+    return true;
+}
+
+bool GlyphExtractor::HasGlyph(int character) const
+{
+    if (m_cacheFile && m_cacheFile->Find(character))
+        return true;
+    return OpenFace() && GlyphIndex(character) != 0;
+}
+
+bool GlyphExtractor::SetFallbackFonts(const vector<string> &filenames)
+{
+    m_fallbacks.clear();
+
+    bool opened = true;
+    for (size_t f = 0; f < filenames.size(); ++f)
+    {
+        // the face and its character map are charged to the fallback font
+        if (m_allocator) m_allocator->SetOwner(m_registry.FaceId(filenames[f]));
+        FontHandle font = m_registry.Open(filenames[f]);
+        if (!font) {
+            opened = false;
+            continue;
+        }
+
+        m_fallbacks.push_back(font);
+    }
+
+    if (m_allocator) m_allocator->SetOwner(m_fontId);
+    return opened;
+}
+
+int GlyphExtractor::FallbackFontFor(int character) const
+{
+    if (m_cacheFile && m_cacheFile->Find(character))
+        return -1;
+    if (!OpenFace() || GlyphIndex(character) != 0)
+        return -1;
+
+    for (size_t f = 0; f < m_fallbacks.size(); ++f) {
+        if (m_fallbacks[f]->cmap.GlyphIndex(character) != 0)
+            return f;
+    }
+    return -1;
+}
+
+FontFace *GlyphExtractor::ResolveGlyph(int character, unsigned int &index) const
+{
+    if (!OpenFace())
+        return 0;
+
+    index = GlyphIndex(character);
+    if (index != 0)
+        return m_font.get();
+
+    int f = FallbackFontFor(character);
+    if (f < 0)
+        return m_font.get();
+
+    FontFace *fallback = m_fallbacks[f].get();
+    index = fallback->cmap.GlyphIndex(character);
+    return fallback;
+}
+
 // --------------------------------------------------------------------------
 
 void GlyphExtractor::PrintFontInformation() const
@@ -66,14 +271,14 @@ void GlyphExtractor::PrintFontInformation() const
     cout << "  Units per EM: \t" << m_face->units_per_EM << endl;
 }
 
-void GlyphExtractor::PrintGlyphInformation(int character) const
+void GlyphExtractor::PrintGlyphInformation(FT_Face face, int character) const
 {
-    FT_Outline &outline = m_face->glyph->outline;
+    FT_Outline &outline = face->glyph->outline;
 
     cout << "Glyph information for character "
          << character << " (" << char(character) << "):" <<  endl;
-    cout << "  Advance: " << m_face->glyph->advance.x
-         << ", " << m_face->glyph->advance.y << endl;
+    cout << "  Advance: " << face->glyph->advance.x
+         << ", " << face->glyph->advance.y << endl;
     cout << "  Number of contours: " << outline.n_contours << endl;
     cout << "  Number of points:   " << outline.n_points << endl;
 
@@ -90,123 +295,742 @@ void GlyphExtractor::PrintGlyphInformation(int character) const
 
 // --------------------------------------------------------------------------
 
-MyGlyph GlyphExtractor::ExtractGlyph(int character) const
+// builds the contours of a MyGlyph
+struct GlyphSink
 {
-    // first check that a font has been loaded
-    if (!m_face) {
-        cout << "GlyphExtractor ERROR: No font loaded!" << endl;
-        return MyGlyph();
+    MyGlyph &glyph;
+    MyContour contour;
+
+    GlyphSink(MyGlyph &g) : glyph(g) {}
+    void BeginContour()                     { contour.clear(); }
+    void AddSegment(const MySegment &s)     { contour.push_back(s); }
+    void EndContour()                       { glyph.contours.push_back(contour); }
+};
+
+// converted points of the outline being decoded, one buffer per thread
+static thread_local EMOutlineBuffer s_converted;
+
+// decodes a loaded outline into the sink, either converting all of its
+// points to EM units in one batch first or converting them one at a time
+template <class Sink>
+static void DecodeSlot(const FT_Outline &outline, float em, bool batch, Sink &sink)
+{
+    if (batch) {
+        ConvertToEM(outline.points, outline.tags, outline.n_points, em, s_converted);
+        DecodeOutline(MakeEMOutlineSource(s_converted, outline.contours, outline.n_contours),
+                      1.0f, sink);
     }
+    else
+        DecodeOutline(FTOutlineSource(outline), em, sink);
+}
 
-    // look up the glyph index for the given character code
-    int index = FT_Get_Char_Index(m_face, character);
+// same, with cubics replaced by quadratics within tolerance if it is above 0
+template <class Sink>
+static void DecodeSlot(const FT_Outline &outline, float em, bool batch,
+                       float tolerance, Sink &sink)
+{
+    if (tolerance > 0) {
+        QuadraticSink<Sink> quadratic(sink, tolerance);
+        DecodeSlot(outline, em, batch, quadratic);
+    }
+    else
+        DecodeSlot(outline, em, batch, sink);
+}
+
+// replaces the cubics of a glyph that was stored with them
+static void ApproximateGlyphCubics(MyGlyph &glyph, float tolerance)
+{
+    vector<MySegment> quadratics;
+    for (size_t c = 0; c < glyph.contours.size(); ++c)
+    {
+        MyContour &contour = glyph.contours[c];
+        MyContour converted;
+        for (size_t s = 0; s < contour.size(); ++s)
+        {
+            if (contour[s].degree != 3) {
+                converted.push_back(contour[s]);
+                continue;
+            }
+            quadratics.clear();
+            CubicToQuadratics(contour[s], tolerance, quadratics);
+            converted.insert(converted.end(), quadratics.begin(), quadratics.end());
+        }
+        contour.swap(converted);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+FT_Face GlyphExtractor::LoadGlyphOutline(int character) const
+{
+    // look up the face and glyph index for the given character code, which
+    // also checks that a font has been loaded
+    unsigned int index;
+    FontFace *font = ResolveGlyph(character, index);
+    if (!font)
+        return 0;
 
     // load the glyph for the given character into the face glyph slot,
     // keeping the outline in original font units
-    FT_Error error = FT_Load_Glyph(m_face, index, FT_LOAD_NO_SCALE);
-    if (error || m_face->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
+    FT_Face face = font->face;
+    FT_Error error = FT_Load_Glyph(face, index, FT_LOAD_NO_SCALE);
+    if (error || face->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
     {
         cout << "FreeType ERROR: Could not find glyph outline for character "
              << character << " (" << char(character) << ")" <<  endl;
-        return MyGlyph();
+        return 0;
     }
 
-    if (DEBUG_PRINT) PrintGlyphInformation(character);
+    if (DEBUG_PRINT) PrintGlyphInformation(face, character);
+
+    return face;
+}
+
+MyGlyph GlyphExtractor::ExtractGlyph(int character) const
+{
+    MyGlyph stored;
+    if (m_cacheFile && m_cacheFile->Glyph(character, stored)) {
+        if (m_quadraticTolerance > 0)
+            ApproximateGlyphCubics(stored, m_quadraticTolerance);
+        return stored;
+    }
+
+    FT_Face face = LoadGlyphOutline(character);
+    if (!face)
+        return MyGlyph();
 
     // create a new glyph structure to populate with this character outline
-    FT_Outline &outline = m_face->glyph->outline;
-    float em = m_face->units_per_EM;
-    MyGlyph glyph(m_face->glyph->advance.x / em);
+    float em = face->units_per_EM;
+    MyGlyph glyph(face->glyph->advance.x / em);
+
+    GlyphSink sink(glyph);
+    DecodeSlot(face->glyph->outline, em, m_batchConversion, m_quadraticTolerance, sink);
+
+    return glyph;
+}
 
-    // current point index
-    int begin = 0;
+MyOutline GlyphExtractor::ExtractOutline(int character)
+{
+    MyOutline outline;
+    if (m_cacheFile && m_cacheFile->Outline(character, outline))
+        return m_quadraticTolerance > 0 ? ApproximateCubics(outline) : outline;
+    FT_Face face = LoadGlyphOutline(character);
+    if (!face)
+        return outline;
+
+    // decode into reusable scratch buffers, then copy into the arena once
+    // the final sizes are known
+    m_scratchSegments.clear();
+    m_scratchContours.clear();
+    FlatSink sink(m_scratchSegments, m_scratchContours);
+    DecodeSlot(face->glyph->outline, face->units_per_EM, m_batchConversion,
+               m_quadraticTolerance, sink);
 
-    // iterate through the outline's contours
-    for (int c = 0; c < outline.n_contours; ++c)
+    return CopyScratchOutline(face->glyph->advance.x / float(face->units_per_EM));
+}
+
+MyOutline GlyphExtractor::ApproximateCubics(const MyOutline &outline)
+{
+    m_scratchSegments.clear();
+    m_scratchContours.clear();
+    FlatSink flat(m_scratchSegments, m_scratchContours);
+    QuadraticSink<FlatSink> sink(flat, m_quadraticTolerance);
+    for (unsigned int c = 0; c < outline.contourCount; ++c)
     {
-        MyContour contour;
+        sink.BeginContour();
+        for (const MySegment *s = outline.ContourBegin(c); s != outline.ContourEnd(c); ++s)
+            sink.AddSegment(*s);
+        sink.EndContour();
+    }
+    return CopyScratchOutline(outline.advance);
+}
 
-        // iterate through current contour's points
-        int end = outline.contours[c];
-        for (int p = begin; p <= end; ++p)
-        {
-            // index for next point, q
-            int q = p+1;
-            if (q > end) q = begin;
+MyOutline GlyphExtractor::CopyScratchOutline(float advance)
+{
+    MyOutline outline;
+    outline.advance = advance;
 
-            // retrieve position vectors
-            FT_Vector r_p = outline.points[p];
-            FT_Vector r_q = outline.points[q];
+    MySegment *segments = m_arena.Allocate<MySegment>(m_scratchSegments.size());
+    MyContourSpan *contours = m_arena.Allocate<MyContourSpan>(m_scratchContours.size());
+    if (!segments || !contours) {
+        cout << "GlyphExtractor ERROR: Out of memory for glyph outline" << endl;
+        return outline;
+    }
 
-            // create a segment to store control points
-            MySegment segment;
+    copy(m_scratchSegments.begin(), m_scratchSegments.end(), segments);
+    copy(m_scratchContours.begin(), m_scratchContours.end(), contours);
+    outline.segments = segments;
+    outline.segmentCount = m_scratchSegments.size();
+    outline.contours = contours;
+    outline.contourCount = m_scratchContours.size();
+    return outline;
+}
 
-            if (outline.tags[p] & 1) {
-                segment.x[0] = r_p.x / em;
-                segment.y[0] = r_p.y / em;
-            }
-            else {
-                segment.x[0] = 0.5f * (r_p.x + r_q.x) / em;
-                segment.y[0] = 0.5f * (r_p.y + r_q.y) / em;
+// --------------------------------------------------------------------------
+
+// runs shorter than this are extracted on the calling thread, as opening a
+// face per worker would cost more than it saves
+static const int PARALLEL_THRESHOLD = 64;
+
+// Extracts every stride-th character of a run, starting at first, using a
+// library and face of its own opened over the shared font file data. Glyph
+// indices come from the given character map, or from the face if there is
+// none; progress, if given, is bumped once per character, and mapped, if
+// given, records which characters the face has a glyph for, and the others
+// are left empty. Glyphs that fail to load are reported and left empty.
+// Returns false if the face could not be opened.
+static bool ExtractRun(const MappedFileHandle &data, const CharacterMap *cmap,
+                       bool batch, float tolerance, const int *characters, int count,
+                       int first, int stride, MyGlyph *glyphs,
+                       atomic<unsigned int> *progress = 0,
+                       unsigned char *mapped = 0)
+{
+    FT_Library library;
+    if (FT_Init_FreeType(&library))
+        return false;
+
+    FT_Face face;
+    if (FT_New_Memory_Face(library, data->Data(), FT_Long(data->Size()), 0, &face)) {
+        FT_Done_FreeType(library);
+        return false;
+    }
+
+    float em = face->units_per_EM;
+    for (int i = first; i < count; i += stride)
+    {
+        FT_UInt index = cmap ? cmap->GlyphIndex(characters[i])
+                             : FT_Get_Char_Index(face, characters[i]);
+        // with mapped given, characters the face lacks are left empty
+        if (mapped) {
+            mapped[i] = index != 0;
+            if (!mapped[i]) {
+                if (progress) ++*progress;
+                continue;
             }
+        }
+        FT_Error error = FT_Load_Glyph(face, index, FT_LOAD_NO_SCALE);
+        if (!error && face->glyph->format == FT_GLYPH_FORMAT_OUTLINE)
+        {
+            glyphs[i].advance = face->glyph->advance.x / em;
+            GlyphSink sink(glyphs[i]);
+            DecodeSlot(face->glyph->outline, em, batch, tolerance, sink);
+        }
+        else
+            cout << "FreeType ERROR: Could not find glyph outline for character "
+                 << characters[i] << " (" << char(characters[i]) << ")" << endl;
+        if (progress) ++*progress;
+    }
 
-            // set degree of segment based on what the next point is
-            if (outline.tags[q] & 1)
-            {
-                // next point is on curve, so this is a line segment
-                segment.degree = 1;
-                segment.x[1] = r_q.x / em;
-                segment.y[1] = r_q.y / em;
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+    return true;
+}
+
+vector<MyGlyph> GlyphExtractor::ExtractGlyphs(const int *characters, int count,
+                                              unsigned char *mapped)
+{
+    vector<MyGlyph> glyphs(count);
+    if (!OpenFace())
+        return glyphs;
+
+    // extracts every stride-th character from first on this thread
+    auto extractHere = [&](int first, int stride) {
+        for (int i = first; i < count; i += stride) {
+            if (mapped) {
+                mapped[i] = GlyphIndex(characters[i]) != 0;
+                if (!mapped[i]) continue;
             }
-            else if (outline.tags[q] & 2)
+            glyphs[i] = ExtractGlyph(characters[i]);
+        }
+    };
+
+    if (!m_pool) m_pool = new ThreadPool;
+    int workers = min<int>(m_pool->ThreadCount(), count / PARALLEL_THRESHOLD);
+
+    // workers share the font's mapping, mapping the file now if FreeType
+    // has been reading it itself
+    MappedFileHandle data = m_font->mapping;
+    if (!data && workers > 1)
+        data = MappedFile::Open(m_font->filename);
+
+    if (!data || workers < 2) {
+        extractHere(0, 1);
+        return glyphs;
+    }
+
+    // interleave characters across workers so each gets a similar mix
+    const CharacterMap &cmap = m_font->cmap;
+    bool batch = m_batchConversion;
+    float tolerance = m_quadraticTolerance;
+    MyGlyph *results = &glyphs[0];
+    vector<unsigned char> opened(workers);
+    unsigned char *workerOpened = &opened[0];
+
+    for (int w = 0; w < workers; ++w) {
+        m_pool->Submit([=, &cmap]() {
+            workerOpened[w] = ExtractRun(data, &cmap, batch, tolerance, characters, count,
+                                         w, workers, results, 0, mapped);
+        });
+    }
+    m_pool->Wait();
+
+    // a worker that could not open its face leaves its share to be
+    // extracted here, one glyph at a time
+    for (int w = 0; w < workers; ++w) {
+        if (!opened[w]) {
+            cout << "GlyphExtractor ERROR: Could not open a face for worker " << w
+                 << ", extracting its glyphs on this thread" << endl;
+            extractHere(w, workers);
+        }
+    }
+
+    // characters this font does not map come from the fallback fonts
+    for (int i = 0; i < count && !mapped && !m_fallbacks.empty(); ++i) {
+        if (FallbackFontFor(characters[i]) >= 0)
+            glyphs[i] = ExtractGlyph(characters[i]);
+    }
+
+    return glyphs;
+}
+
+void GlyphExtractor::PreloadGlyphs(const int *characters, int count)
+{
+    if (!OpenFace())
+        return;
+
+    // characters the font does not map are left out, as when prewarming
+    vector<unsigned char> mapped(count);
+    vector<MyGlyph> glyphs = ExtractGlyphs(characters, count, mapped.data());
+    for (int i = 0; i < count; ++i)
+    {
+        if (!mapped[i]) continue;
+        unsigned long long key = (unsigned long long)m_fontId << 32
+                               | (unsigned int)characters[i];
+        if (!m_outlineCache.count(key))
+            m_outlineCache[key] = FlattenGlyph(glyphs[i]);
+    }
+}
+
+MyOutline GlyphExtractor::FlattenGlyph(const MyGlyph &glyph)
+{
+    MyOutline outline;
+    outline.advance = glyph.advance;
+
+    unsigned int segmentCount = 0;
+    for (size_t c = 0; c < glyph.contours.size(); ++c)
+        segmentCount += glyph.contours[c].size();
+
+    MySegment *segments = m_arena.Allocate<MySegment>(segmentCount);
+    MyContourSpan *contours = m_arena.Allocate<MyContourSpan>(glyph.contours.size());
+    if (!segments || !contours) {
+        cout << "GlyphExtractor ERROR: Out of memory for glyph outline" << endl;
+        return outline;
+    }
+    outline.segmentCount = segmentCount;
+    outline.contourCount = glyph.contours.size();
+
+    unsigned int begin = 0;
+    for (size_t c = 0; c < glyph.contours.size(); ++c)
+    {
+        const MyContour &contour = glyph.contours[c];
+        copy(contour.begin(), contour.end(), segments + begin);
+        contours[c].begin = begin;
+        contours[c].count = contour.size();
+        begin += contour.size();
+    }
+
+    outline.segments = segments;
+    outline.contours = contours;
+    return outline;
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphExtractor::PrewarmFonts(const vector<string> &fonts,
+                                  const vector<int> &characters)
+{
+    // a new request replaces any earlier one, after it finishes
+    delete m_prewarm;
+    m_prewarm = 0;
+
+    vector<string> pending;
+    for (size_t f = 0; f < fonts.size(); ++f) {
+        if (!m_cacheFiles.count(fonts[f]) && !m_prewarmedFonts.count(fonts[f]))
+            pending.push_back(fonts[f]);
+    }
+    if (pending.empty() || characters.empty())
+        return;
+
+    // one task per font, so fonts are prewarmed side by side
+    unsigned int cores = max(thread::hardware_concurrency(), 1u);
+    m_prewarm = new PrewarmState(min<unsigned int>(cores, pending.size()));
+    m_prewarm->characters = characters;
+    m_prewarm->total = pending.size() * characters.size();
+    m_prewarm->tolerance = m_quadraticTolerance;
+
+    PrewarmState *state = m_prewarm;
+    bool batch = m_batchConversion;
+    float tolerance = m_quadraticTolerance;
+    for (size_t f = 0; f < pending.size(); ++f)
+    {
+        shared_ptr<PrewarmFont> font = make_shared<PrewarmFont>(pending[f],
+                                                                m_registry.FaceId(pending[f]));
+        font->glyphs.resize(characters.size());
+        font->mapped.resize(characters.size());
+        state->fonts.push_back(font);
+
+        state->pool.Submit([state, font, batch, tolerance]() {
+            MappedFileHandle data = MappedFile::Open(font->filename);
+            const vector<int> &characters = state->characters;
+            font->opened = data && ExtractRun(data, 0, batch, tolerance,
+                                              &characters[0], characters.size(),
+                                              0, 1, &font->glyphs[0], &state->done,
+                                              &font->mapped[0]);
+            font->ready = true;
+        });
+    }
+}
+
+bool GlyphExtractor::CollectPrewarmedFonts()
+{
+    if (!m_prewarm)
+        return true;
+
+    bool finished = true;
+    for (size_t f = 0; f < m_prewarm->fonts.size(); ++f)
+    {
+        PrewarmFont &font = *m_prewarm->fonts[f];
+        if (font.collected) continue;
+        if (!font.ready) {
+            finished = false;
+            continue;
+        }
+
+        // fonts that failed to open are left to the usual loading path,
+        // which reports the error
+        font.collected = true;
+        if (!font.opened) continue;
+
+        // characters the font does not map are left out, so they are
+        // extracted when asked for and can come from a fallback font; so are
+        // all of them if the quadratic tolerance changed since they were
+        const vector<int> &characters = m_prewarm->characters;
+        bool current = m_prewarm->tolerance == m_quadraticTolerance;
+        for (size_t i = 0; current && i < characters.size(); ++i)
+        {
+            if (!font.mapped[i]) continue;
+            unsigned long long key = (unsigned long long)font.id << 32
+                                   | (unsigned int)characters[i];
+            if (!m_outlineCache.count(key))
+                m_outlineCache[key] = FlattenGlyph(font.glyphs[i]);
+        }
+        m_prewarmedFonts.insert(font.filename);
+        vector<MyGlyph>().swap(font.glyphs);
+        vector<unsigned char>().swap(font.mapped);
+    }
+
+    if (finished) {
+        delete m_prewarm;
+        m_prewarm = 0;
+    }
+    return finished;
+}
+
+float GlyphExtractor::PrewarmProgress() const
+{
+    if (!m_prewarm || m_prewarm->total == 0)
+        return 1.0f;
+    return float(m_prewarm->done) / m_prewarm->total;
+}
+
+// --------------------------------------------------------------------------
+
+MemoryStats GlyphExtractor::FontMemoryStats(const string &filename)
+{
+    return m_allocator ? m_allocator->Stats(m_registry.FaceId(filename)) : MemoryStats();
+}
+
+MemoryStats GlyphExtractor::LibraryMemoryStats() const
+{
+    return m_allocator ? m_allocator->Stats(-1) : MemoryStats();
+}
+
+MemoryStats GlyphExtractor::TotalMemoryStats() const
+{
+    return m_allocator ? m_allocator->TotalStats() : MemoryStats();
+}
+
+// --------------------------------------------------------------------------
+
+bool GlyphExtractor::GetGlyphMetrics(int character, MyGlyphMetrics &metrics) const
+{
+    if (m_cacheFile && m_cacheFile->Metrics(character, metrics))
+        return true;
+    unsigned int index;
+    FontFace *font = ResolveGlyph(character, index);
+    if (!font)
+        return false;
+
+    // loading the glyph fills in its metrics; the outline is left undecoded
+    FT_Face face = font->face;
+    if (FT_Load_Glyph(face, index, FT_LOAD_NO_SCALE))
+        return false;
+
+    const FT_Glyph_Metrics &m = face->glyph->metrics;
+    float em = face->units_per_EM;
+    metrics.advance = m.horiAdvance / em;
+    metrics.xMin = m.horiBearingX / em;
+    metrics.yMax = m.horiBearingY / em;
+    metrics.xMax = (m.horiBearingX + m.width) / em;
+    metrics.yMin = (m.horiBearingY - m.height) / em;
+    return true;
+}
+
+MyFaceMetrics GlyphExtractor::GetFaceMetrics() const
+{
+    if (m_cacheFile)
+        return m_cacheFile->FaceMetrics();
+
+    MyFaceMetrics metrics;
+    if (!OpenFace())
+        return metrics;
+
+    float em = m_face->units_per_EM;
+    metrics.ascent = m_face->ascender / em;
+    metrics.descent = m_face->descender / em;
+    metrics.lineGap = (m_face->height - m_face->ascender + m_face->descender) / em;
+    return metrics;
+}
+
+void GlyphExtractor::GetAdvances(const int *characters, int count, float *advances)
+{
+    if (!m_cacheFile && !OpenFace()) {
+        fill(advances, advances + count, 0.0f);
+        return;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        // characters in the glyph cache file need no face
+        const GlyphCacheRecord *record = m_cacheFile ? m_cacheFile->Find(characters[i]) : 0;
+        if (record) {
+            advances[i] = record->advance;
+            continue;
+        }
+        unsigned int index;
+        FontFace *font = ResolveGlyph(characters[i], index);
+        if (!font) {
+            advances[i] = 0;
+            continue;
+        }
+
+        FT_Face face = font->face;
+        vector<float> &known = font->advances;
+        if (known.empty())
+            known.assign(face->num_glyphs, -1.0f);
+
+        if (index >= known.size()) {
+            advances[i] = 0;
+            continue;
+        }
+
+        // FT_Get_Advance reads the metrics tables directly where it can,
+        // without loading the glyph
+        if (known[index] < 0) {
+            FT_Fixed advance = 0;
+            FT_Get_Advance(face, index, FT_LOAD_NO_SCALE, &advance);
+            known[index] = advance / float(face->units_per_EM);
+        }
+        advances[i] = known[index];
+    }
+}
+
+vector<float> GlyphExtractor::GetAdvances(const string &text)
+{
+    vector<int> characters;
+    DecodeUtf8(text, characters);
+    vector<float> advances(characters.size());
+    if (!characters.empty())
+        GetAdvances(&characters[0], characters.size(), &advances[0]);
+    return advances;
+}
+
+float GlyphExtractor::GetKerning(int left, int right) const
+{
+    float kerning;
+    if (m_cacheFile && m_cacheFile->Kerning(left, right, kerning))
+        return kerning;
+
+    // pairs are only kerned when both glyphs come from the same face
+    unsigned int leftIndex, rightIndex;
+    FontFace *font = ResolveGlyph(left, leftIndex);
+    if (!font || font != ResolveGlyph(right, rightIndex))
+        return 0;
+
+    int units = font->kerning.Kerning(font->face, leftIndex, rightIndex);
+    return units / float(font->face->units_per_EM);
+}
+
+void GlyphExtractor::GetKerningPairs(const vector<int> &characters,
+                                     vector<MyKerningPair> &pairs) const
+{
+    pairs.clear();
+    if (!OpenFace())
+        return;
+
+    const KerningTable &table = m_font->kerning;
+    if (m_cacheFile || table.UsesFreeType())
+    {
+        for (size_t l = 0; l < characters.size(); ++l)
+        {
+            for (size_t r = 0; r < characters.size(); ++r)
             {
-                // next point is third degree, so this is a cubic segment
-                segment.degree = 3;
-                for (int i = 0; i < 3; ++i)
-                {
-                    segment.x[1+i] = r_q.x / em;
-                    segment.y[1+i] = r_q.y / em;
-                    if (++q > end) q = begin;
-                    r_q = outline.points[q];
-                }
-                p += 2;
+                MyKerningPair pair;
+                pair.left = characters[l];
+                pair.right = characters[r];
+                pair.kerning = GetKerning(pair.left, pair.right);
+                if (pair.kerning != 0) pairs.push_back(pair);
             }
-            else
+        }
+        return;
+    }
+
+    // the given characters of each glyph, as several can share one
+    unordered_map<unsigned int, vector<int> > glyphCharacters;
+    for (size_t i = 0; i < characters.size(); ++i) {
+        unsigned int index = GlyphIndex(characters[i]);
+        if (index != 0) glyphCharacters[index].push_back(characters[i]);
+    }
+
+    float em = m_face->units_per_EM;
+    const unordered_map<unsigned int, short> &tablePairs = table.Pairs();
+    for (unordered_map<unsigned int, short>::const_iterator p = tablePairs.begin();
+         p != tablePairs.end(); ++p)
+    {
+        if (p->second == 0) continue;
+        unordered_map<unsigned int, vector<int> >::const_iterator left =
+            glyphCharacters.find(p->first >> 16);
+        unordered_map<unsigned int, vector<int> >::const_iterator right =
+            glyphCharacters.find(p->first & 0xFFFF);
+        if (left == glyphCharacters.end() || right == glyphCharacters.end())
+            continue;
+
+        for (size_t l = 0; l < left->second.size(); ++l)
+        {
+            for (size_t r = 0; r < right->second.size(); ++r)
             {
-                // next point is second degree, so this is a quadratic segment
-                segment.degree = 2;
-                segment.x[1] = r_q.x / em;
-                segment.y[1] = r_q.y / em;
-
-                // advance q
-                if (++q > end) q = begin;
-                r_q = outline.points[q];
-
-                // if the next point is on curve, store and advance p
-                if (outline.tags[q] & 1) {
-                    segment.x[2] = r_q.x / em;
-                    segment.y[2] = r_q.y / em;
-                    ++p;
-                }
-                // otherwise store the midpoint
-                else {
-                    segment.x[2] = 0.5f * (segment.x[1] + r_q.x / em);
-                    segment.y[2] = 0.5f * (segment.y[1] + r_q.y / em);
-                }
+                MyKerningPair pair;
+                pair.left = left->second[l];
+                pair.right = right->second[r];
+                pair.kerning = p->second / em;
+                pairs.push_back(pair);
             }
-
-            // add segment to contour
-            contour.push_back(segment);
         }
+    }
+}
 
-        // set beginning of next contour
-        begin = end + 1;
+// --------------------------------------------------------------------------
+
+const MyGlyph &GlyphExtractor::CachedGlyph(int character)
+{
+    static const MyGlyph empty;
+    if (!m_cacheFile && !OpenFace())
+        return empty;
 
-        // add contour to glyph
-        glyph.contours.push_back(contour);
+    unsigned long long key = (unsigned long long)m_fontId << 32
+                           | (unsigned int)character;
+
+    unordered_map<unsigned long long, MyGlyph>::iterator it = m_glyphCache.find(key);
+    if (it != m_glyphCache.end()) {
+        ++m_cacheHits;
+        return it->second;
     }
 
-    return glyph;
+    // glyphs that fail to extract are cached empty so we only complain once
+    ++m_cacheMisses;
+    return m_glyphCache.insert(make_pair(key, ExtractGlyph(character))).first->second;
+}
+
+const MyOutline &GlyphExtractor::CachedOutline(int character)
+{
+    static const MyOutline empty;
+    if (!m_cacheFile && !OpenFace())
+        return empty;
+
+    unsigned long long key = (unsigned long long)m_fontId << 32
+                           | (unsigned int)character;
+
+    const CompactGlyph *compact = m_compactCache ? m_compact->Find(key) : 0;
+    if (compact) {
+        ++m_cacheHits;
+        m_compact->Decode(*compact, m_scratchSegments, m_scratchContours, m_decoded,
+                          m_quadraticTolerance);
+        return m_decoded;
+    }
+
+    // preloaded glyphs, and glyphs too large for the compact form, are
+    // kept flat even in compact mode
+    unordered_map<unsigned long long, MyOutline>::iterator it = m_outlineCache.find(key);
+    if (it != m_outlineCache.end()) {
+        ++m_cacheHits;
+        return it->second;
+    }
+
+    ++m_cacheMisses;
+
+    // glyphs from a cache file are used where they lie, in either mode
+    MyOutline stored;
+    if (m_cacheFile && m_cacheFile->Outline(character, stored)) {
+        if (m_quadraticTolerance > 0)
+            stored = ApproximateCubics(stored);
+        return m_outlineCache.insert(make_pair(key, stored)).first->second;
+    }
+
+    if (m_compactCache)
+    {
+        bool added = true;
+        FT_Face face = LoadGlyphOutline(character);
+        if (!face)
+            m_compact->AddEmpty(key, 0, m_face ? m_face->units_per_EM : 1);
+        else
+            added = m_compact->Add(key, face->glyph->outline,
+                                   face->glyph->advance.x, face->units_per_EM);
+
+        if (added) {
+            m_compact->Decode(*m_compact->Find(key), m_scratchSegments,
+                              m_scratchContours, m_decoded, m_quadraticTolerance);
+            return m_decoded;
+        }
+    }
+
+    return m_outlineCache.insert(make_pair(key, ExtractOutline(character))).first->second;
+}
+
+void GlyphExtractor::SetCompactCache(bool enable)
+{
+    m_compactCache = enable;
+}
+
+void GlyphExtractor::SetQuadraticTolerance(float tolerance)
+{
+    if (tolerance == m_quadraticTolerance)
+        return;
+    m_quadraticTolerance = tolerance;
+    ClearGlyphCache();
+}
+
+size_t GlyphExtractor::CompactCacheBytes() const
+{
+    return m_compact->BytesUsed();
+}
+
+void GlyphExtractor::ClearGlyphCache()
+{
+    m_glyphCache.clear();
+    m_outlineCache.clear();
+    m_arena.Reset();
+    m_compact->Clear();
+    m_cacheHits = m_cacheMisses = 0;
 }
 
 // --------------------------------------------------------------------------
@@ -9,6 +9,9 @@
 //  - A contour consists of one or more segments (stored as std::vector)
 //  - A segment is either a straight line, quadratic Bezier, or cubic Bezier
 //
+// Glyphs can also be retrieved as a MyOutline, which stores the same
+// segments in one flat array owned by the extractor, with a span per contour.
+//
 // You may use this code (or not) however you see fit for your work.
 //
 // Author:  Sonny Chan
@@ -18,12 +21,22 @@
 #ifndef GLYPHEXTRACTOR_H
 #define GLYPHEXTRACTOR_H
 
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include "FontRegistry.h"
+#include "OutlineArena.h"
+#include "PoolAllocator.h"
+
+class CompactOutlineStore;
+class ThreadPool;
+class GlyphCacheFile;
+
 // --------------------------------------------------------------------------
 // DATA STRUCTURES: Segment, Contour, and Glyph
 
@@ -57,27 +70,308 @@ struct MyGlyph
     {}
 };
 
+// A kerning pair of characters and its adjustment, in EM units.
+struct MyKerningPair
+{
+    int left, right;
+    float kerning;
+};
+
+// Metrics of a single glyph, in EM units, available without its outline.
+struct MyGlyphMetrics
+{
+    // advance width to next glyph
+    float advance;
+
+    // bounding box of the glyph outline
+    float xMin, yMin, xMax, yMax;
+
+    MyGlyphMetrics() : advance(0), xMin(0), yMin(0), xMax(0), yMax(0)
+    {}
+};
+
+// Vertical metrics of a face, in EM units. Descent is negative (below the
+// baseline); the distance between baselines is ascent - descent + lineGap.
+struct MyFaceMetrics
+{
+    float ascent, descent, lineGap;
+
+    MyFaceMetrics() : ascent(0), descent(0), lineGap(0)
+    {}
+};
+
+// A contour within a flat outline: a range of its segment array.
+struct MyContourSpan
+{
+    unsigned int begin, count;
+};
+
+// A flat glyph outline: all segments of all contours stored contiguously,
+// with one span per contour. The arrays belong to the GlyphExtractor that
+// built the outline and stay valid until its glyph cache is cleared.
+struct MyOutline
+{
+    // advance width to next glyph, in EM units
+    float advance;
+
+    // segments of every contour, in EM-box coordinates
+    const MySegment *segments;
+    unsigned int segmentCount;
+
+    // where each contour's segments are within the array above
+    const MyContourSpan *contours;
+    unsigned int contourCount;
+
+    MyOutline() : advance(0), segments(0), segmentCount(0),
+                  contours(0), contourCount(0)
+    {}
+
+    // first and one-past-last segments of contour c
+    const MySegment *ContourBegin(unsigned int c) const
+    { return segments + contours[c].begin; }
+    const MySegment *ContourEnd(unsigned int c) const
+    { return segments + contours[c].begin + contours[c].count; }
+};
+
 // --------------------------------------------------------------------------
 // This class encapsulates functionality required to load a font file from
 // disk and retrieve glyph outlines for characters from the font.
 
 class GlyphExtractor
 {
+    // pooling allocator the library was created with, if any
+    PoolAllocator *m_allocator;
+
     FT_Library  m_library;
-    FT_Face     m_face;
+
+    // every face opened by this extractor, and a handle to the current one;
+    // these are mutable because a font served from a glyph cache file only
+    // has its face opened when a glyph missing from the file is needed
+    mutable FT_Face      m_face;
+    mutable FontRegistry m_registry;
+    mutable FontHandle   m_font;
+
+    // name and registry id of the current font file
+    std::string m_fontName;
+    int         m_fontId;
+
+    // precompiled glyph cache files by font file name, and the one standing
+    // in for the current font, if any
+    std::map<std::string, std::shared_ptr<GlyphCacheFile> > m_cacheFiles;
+    std::shared_ptr<GlyphCacheFile> m_cacheFile;
+
+    // fonts tried in order for characters the current font does not map;
+    // each one's character map tells which code points it covers
+    std::vector<FontHandle> m_fallbacks;
+
+    // fonts being extracted on background threads, if any, and fonts whose
+    // prewarmed glyphs have been taken into the outline cache
+    struct PrewarmState;
+    PrewarmState *m_prewarm;
+    std::set<std::string> m_prewarmedFonts;
+
+    // glyph cache, keyed by (face id << 32 | character code)
+    std::unordered_map<unsigned long long, MyGlyph> m_glyphCache;
+
+    // flat outline cache with the same keys; outline data lives in the arena
+    std::unordered_map<unsigned long long, MyOutline> m_outlineCache;
+    OutlineArena m_arena;
+    std::vector<MySegment> m_scratchSegments;
+    std::vector<MyContourSpan> m_scratchContours;
+
+    // compact cache used instead of the flat one when enabled; glyphs are
+    // decoded into the scratch buffers above and viewed through m_decoded
+    CompactOutlineStore *m_compact;
+    bool m_compactCache;
+    MyOutline m_decoded;
+
+    // whether outlines are converted to EM units in one batch before decoding
+    bool m_batchConversion;
+
+    // how far, in EM units, quadratics standing in for cubics may stray
+    // from them; 0 keeps cubics
+    float m_quadraticTolerance;
+
+    // worker threads for batch extraction, started the first time needed
+    ThreadPool *m_pool;
+
+    // cache statistics
+    unsigned long m_cacheHits, m_cacheMisses;
 
     // private methods to print font/glyph info, for debugging
     void PrintFontInformation() const;
-    void PrintGlyphInformation(int character) const;
+    void PrintGlyphInformation(FT_Face face, int character) const;
+
+    // copies the scratch segments and contours into a flat outline in the
+    // arena, and makes a copy of an outline with its cubics approximated
+    MyOutline CopyScratchOutline(float advance);
+    MyOutline ApproximateCubics(const MyOutline &outline);
+
+    static FT_Library CreateLibrary(PoolAllocator *allocator);
+
+    // opens the current font's face if it has not been opened yet; prints
+    // an error and returns false if there is no font or it cannot be opened
+    bool OpenFace() const;
+
+    // glyph index for a character, from the current face's character map
+    unsigned int GlyphIndex(int character) const
+    { return m_font->cmap.GlyphIndex(character); }
+
+    // the face a character's glyph comes from, and its glyph index there:
+    // the current font if it maps the character, otherwise the first
+    // fallback font that covers it, otherwise the current font's missing
+    // glyph; null if the current font cannot be opened
+    FontFace *ResolveGlyph(int character, unsigned int &index) const;
+
+    // loads the outline for a character into the glyph slot of the face it
+    // resolves to, and returns that face; null on failure
+    FT_Face LoadGlyphOutline(int character) const;
+
+    GlyphExtractor(const GlyphExtractor &);
+    GlyphExtractor &operator=(const GlyphExtractor &);
 
 public:
-    GlyphExtractor();
+    // pass true to have FreeType allocate through a pooling allocator that
+    // also keeps memory statistics for each font
+    GlyphExtractor(bool pooledMemory = false);
+    ~GlyphExtractor();
 
-    // call this method first to load a font file
+    // call this method first to load a font file; faces stay open in the
+    // registry, so switching back to a file loaded before is cheap
     bool LoadFontFile(const std::string &filename);
 
+    // open fonts loaded from now on over shared memory-mapped files instead
+    // of letting FreeType read them; the mappings are shared process-wide
+    void SetMemoryMappedFonts(bool enable)  { m_registry.SetMemoryMapped(enable); }
+
+    // closes faces other than the current one that are no longer in use
+    void ReleaseUnusedFonts()   { m_registry.ReleaseUnused(); }
+
+    // maps a precompiled glyph cache file (see GlyphCacheFile.h) and uses
+    // it for the font file it was built from: while that font is current,
+    // glyphs, outlines and metrics in the file are served from it without
+    // FreeType, and the font itself is only opened for glyphs it lacks
+    bool UseGlyphCacheFile(const std::string &filename);
+
+    // whether the current font has a glyph for the given character
+    bool HasGlyph(int character) const;
+
+    // sets the fonts that glyphs, metrics and advances come from when the
+    // current font does not map a character; the first font in the list
+    // that covers it is used. Each font is opened here, with the character
+    // map table every face gets, so choosing a font is a table lookup per
+    // font. Glyphs already cached are not affected. Returns false if any
+    // font could not be opened; the others are still used.
+    bool SetFallbackFonts(const std::vector<std::string> &filenames);
+
+    // index in the fallback list of the font a character comes from, or -1
+    // if the current font maps it or no fallback font covers it
+    int FallbackFontFor(int character) const;
+
     // this method retrieves a (possibly composite) glyph for the given character
     MyGlyph ExtractGlyph(int character) const;
+
+    // returns the glyph for the given character from the cache, extracting
+    // it only the first time it is requested for the current font file
+    const MyGlyph &CachedGlyph(int character);
+
+    // metrics queries: these read glyph and face metrics without decoding
+    // any outline into segments, so they are much cheaper than extraction
+    bool GetGlyphMetrics(int character, MyGlyphMetrics &metrics) const;
+    MyFaceMetrics GetFaceMetrics() const;
+
+    // advance widths for a whole run of characters in one call, either code
+    // points or UTF-8 text; advances are remembered per glyph, so repeated
+    // layout costs a table lookup
+    void GetAdvances(const int *characters, int count, float *advances);
+    std::vector<float> GetAdvances(const std::string &text);
+
+    // kerning adjustment between two characters, in EM units, to add to the
+    // left character's advance; read from a table built when the font loads
+    float GetKerning(int left, int right) const;
+
+    // every non-zero kerning pair between the given characters of the
+    // current font, in no particular order. The pairs are read from the
+    // font's pair table, so the cost follows the number of pairs rather than
+    // the square of the characters; only fonts whose kerning has to be asked
+    // of FreeType have every pair tried.
+    void GetKerningPairs(const std::vector<int> &characters,
+                         std::vector<MyKerningPair> &pairs) const;
+
+    // extracts glyphs for a whole run of characters on a thread pool; each
+    // worker opens its own face over the shared data of the current font
+    // file, so this can be used for large character sets. Characters with
+    // no outline come back as empty glyphs. If mapped is given, it records
+    // which characters the current font has a glyph for, and the others are
+    // left empty rather than taken from the fallback fonts.
+    std::vector<MyGlyph> ExtractGlyphs(const int *characters, int count,
+                                       unsigned char *mapped = 0);
+
+    // extracts a run of characters in parallel and adds them to the outline
+    // cache, so later CachedOutline calls for them are hits; as with
+    // prewarming, characters the font does not map are left out, so they
+    // can still come from a fallback font added later
+    void PreloadGlyphs(const int *characters, int count);
+
+    // starts extracting the given characters of every listed font on
+    // background threads, each with a face of its own; fonts that have a
+    // glyph cache file are skipped. Finished fonts are taken into the outline
+    // cache by CollectPrewarmedFonts (and by LoadFontFile); until then, and
+    // for characters not in the set, glyphs are extracted when first asked for.
+    void PrewarmFonts(const std::vector<std::string> &fonts,
+                      const std::vector<int> &characters);
+
+    // takes in every prewarmed font that has finished, without waiting for
+    // the rest; returns true once all of them are done
+    bool CollectPrewarmedFonts();
+
+    // fraction of the prewarm work done so far, 1 if there is none
+    float PrewarmProgress() const;
+
+    // builds a flat outline for the given character in the extractor's arena
+    MyOutline ExtractOutline(int character);
+
+    // copies a glyph into a flat outline in the extractor's arena
+    MyOutline FlattenGlyph(const MyGlyph &glyph);
+
+    // returns the flat outline for the given character from the cache,
+    // extracting it only the first time; the reference and the arrays it
+    // points to stay valid until ClearGlyphCache() is called
+    const MyOutline &CachedOutline(int character);
+
+    // choose whether CachedOutline keeps outlines as flat MySegment arrays
+    // (the default) or in compact 16-bit form that is decoded on each call;
+    // in compact mode the returned outline is only valid until the next call
+    void SetCompactCache(bool enable);
+    bool CompactCache() const           { return m_compactCache; }
+
+    // choose whether outline points are converted to EM units in one
+    // vectorized batch before segments are built (the default), or one at a
+    // time while walking the contours
+    void SetBatchConversion(bool enable)    { m_batchConversion = enable; }
+
+    // choose whether cubic segments are approximated by quadratic ones, each
+    // within tolerance EM units of the cubic, so any font can be drawn with
+    // 3-point patches; 0 (the default) keeps cubics. Changing it clears the
+    // glyph caches, and prewarmed glyphs made with the old setting are dropped.
+    void SetQuadraticTolerance(float tolerance);
+    float QuadraticTolerance() const        { return m_quadraticTolerance; }
+
+    // cache statistics and maintenance
+    unsigned long CacheHits() const     { return m_cacheHits; }
+    unsigned long CacheMisses() const   { return m_cacheMisses; }
+    size_t FlatCacheBytes() const       { return m_arena.BytesAllocated(); }
+    size_t CompactCacheBytes() const;
+    void ClearGlyphCache();
+
+    // FreeType memory statistics, available when the extractor was created
+    // with pooled memory: for one font file (faces, glyph slots and other
+    // allocations made while it was the current font), for the library
+    // itself, and in total; all zero otherwise
+    bool PooledMemory() const           { return m_allocator != 0; }
+    MemoryStats FontMemoryStats(const std::string &filename);
+    MemoryStats LibraryMemoryStats() const;
+    MemoryStats TotalMemoryStats() const;
 };
 
 // --------------------------------------------------------------------------
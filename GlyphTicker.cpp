@@ -0,0 +1,234 @@
+// ==========================================================================
+// Glyph Ticker
+//
+// A single line of text that scrolls right to left forever, fed from a
+// stream. The glyphs on screen live in a fixed ring of slots, each a fixed
+// range of one vertex buffer. When a glyph scrolls off the left edge its
+// slot is recycled, and a glyph is only extracted and uploaded (into its
+// slot, with glBufferSubData) when it is about to come in from the right.
+// Buffer memory and upload bandwidth therefore stay the same no matter how
+// long the ticker runs. Each slot is drawn with the vertex shader's offset
+// uniform, so scrolling itself never touches the buffers.
+// ==========================================================================
+
+#include "GlyphTicker.h"
+#include "TextGeometry.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+
+// positions are moved back towards zero once scrolling passes this far
+static const float REBASE_DISTANCE = 4096.0f;
+
+GlyphTicker::GlyphTicker(float scale, unsigned int slots, unsigned int slotVertices)
+    : m_vertexBuffer(0), m_colourBuffer(0), m_vertexArray(0),
+      m_slots(slots), m_slotVertices(slotVertices), m_head(0), m_used(0),
+      m_queueLimit(4 * slots), m_scroll(0), m_pen(0), m_previous(0),
+      m_starved(true), m_patchSize(0), m_scale(scale), m_colour(1.0f, 1.0f, 1.0f),
+      m_uploads(0), m_bytesUploaded(0)
+{}
+
+GlyphTicker::~GlyphTicker()
+{
+    Destroy();
+}
+
+bool GlyphTicker::Initialize()
+{
+    const GLuint VERTEX_INDEX = 0;
+    const GLuint COLOUR_INDEX = 1;
+    GLsizei vertices = m_slots.size() * m_slotVertices;
+
+    glGenBuffers(1, &m_vertexBuffer);
+    glGenBuffers(1, &m_colourBuffer);
+    glGenVertexArrays(1, &m_vertexArray);
+    glBindVertexArray(m_vertexArray);
+
+    // the buffers are allocated once, at their full size, and only ever
+    // written a slot at a time after that
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * vertices, 0, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(VERTEX_INDEX, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+    glEnableVertexAttribArray(VERTEX_INDEX);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_colourBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * vertices, 0, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(COLOUR_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), 0);
+    glEnableVertexAttribArray(COLOUR_INDEX);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+void GlyphTicker::Destroy()
+{
+    if (!m_vertexArray)
+        return;
+
+    glDeleteVertexArrays(1, &m_vertexArray);
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_colourBuffer);
+    m_vertexArray = m_vertexBuffer = m_colourBuffer = 0;
+    m_used = 0;
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphTicker::Push(const int *characters, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        int c = characters[i];
+        if (c == '\n' || c == '\r' || c == '\t') c = ' ';
+        else if (c < 0x20 || c == 0x7F) continue;
+
+        // two spaces in a row, from a line break after a space for
+        // example, are shown as one
+        if (c == ' ' && !m_queue.empty() && m_queue.back() == ' ') continue;
+        m_queue.push_back(c);
+    }
+}
+
+void GlyphTicker::Upload(GlyphExtractor &extractor, unsigned int slot)
+{
+    Slot &s = m_slots[slot];
+    const MyOutline &outline = extractor.CachedOutline(s.character);
+    s.advance = outline.advance;
+
+    m_vertices.clear();
+    m_colours.clear();
+    AppendGlyphPatches(outline, 0.0f, 0.0f, m_scale, m_patchSize, m_colour,
+                       m_vertices, m_colours);
+
+    if (m_vertices.size() > m_slotVertices) {
+        cout << "GlyphTicker ERROR: Glyph for character " << s.character
+             << " needs " << m_vertices.size() << " vertices, more than the "
+             << m_slotVertices << " in a slot" << endl;
+        s.count = 0;
+        return;
+    }
+    s.count = m_vertices.size();
+    if (s.count == 0)
+        return;
+
+    GLintptr first = GLintptr(slot) * m_slotVertices;
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(vec2), s.count * sizeof(vec2), m_vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, m_colourBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(vec3), s.count * sizeof(vec3), m_colours.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    ++m_uploads;
+    m_bytesUploaded += s.count * (sizeof(vec2) + sizeof(vec3));
+}
+
+void GlyphTicker::Rebuild(GlyphExtractor &extractor)
+{
+    // glyphs keep their order, and the first keeps its place, but the rest
+    // move to the new font's advances and kerning
+    float x = m_used > 0 ? m_slots[m_head].x : m_pen;
+    int previous = 0;
+    for (unsigned int i = 0; i < m_used; ++i)
+    {
+        unsigned int slot = (m_head + i) % m_slots.size();
+        Slot &s = m_slots[slot];
+        if (previous) x += extractor.GetKerning(previous, s.character);
+        s.x = x;
+        Upload(extractor, slot);
+        x += s.advance;
+        previous = s.character;
+    }
+    if (m_used > 0) m_pen = x;
+}
+
+void GlyphTicker::Advance(GlyphExtractor &extractor, const string &font,
+                          int patchSize, float distance, float viewWidth)
+{
+    extractor.LoadFontFile(font);
+    if (font != m_font || patchSize != m_patchSize) {
+        m_font = font;
+        m_patchSize = patchSize;
+        Rebuild(extractor);
+    }
+
+    m_scroll += distance;
+
+    // recycle the slots of glyphs that are entirely off the left edge
+    while (m_used > 0)
+    {
+        const Slot &s = m_slots[m_head];
+        if (s.x + s.advance > m_scroll) break;
+        m_head = (m_head + 1) % m_slots.size();
+        --m_used;
+    }
+
+    // bring in glyphs as their pen position reaches the right edge
+    float right = m_scroll + viewWidth;
+    while (m_pen < right)
+    {
+        if (m_queue.empty()) {
+            m_starved = true;
+            break;
+        }
+        if (m_used == m_slots.size())
+            break;
+
+        if (m_starved) {
+            m_pen = max(m_pen, right);
+            m_previous = 0;
+            m_starved = false;
+        }
+
+        int c = m_queue.front();
+        m_queue.pop_front();
+        if (m_previous) m_pen += extractor.GetKerning(m_previous, c);
+
+        unsigned int slot = (m_head + m_used) % m_slots.size();
+        Slot &s = m_slots[slot];
+        s.character = c;
+        s.x = m_pen;
+        Upload(extractor, slot);
+        ++m_used;
+
+        m_pen += s.advance;
+        m_previous = c;
+    }
+
+    if (m_scroll > REBASE_DISTANCE)
+    {
+        m_scroll -= REBASE_DISTANCE;
+        m_pen -= REBASE_DISTANCE;
+        for (unsigned int i = 0; i < m_used; ++i)
+            m_slots[(m_head + i) % m_slots.size()].x -= REBASE_DISTANCE;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphTicker::Draw(GLuint program, const vec2 &origin) const
+{
+    GLint offsetLocation = glGetUniformLocation(program, "offset");
+    glBindVertexArray(m_vertexArray);
+
+    for (unsigned int i = 0; i < m_used; ++i)
+    {
+        unsigned int slot = (m_head + i) % m_slots.size();
+        const Slot &s = m_slots[slot];
+        if (s.count == 0) continue;
+
+        vec2 offset = origin + vec2((s.x - m_scroll) * m_scale, 0.0f);
+        glUniform2f(offsetLocation, offset.x, offset.y);
+        glDrawArrays(GL_PATCHES, slot * m_slotVertices, s.count);
+    }
+
+    glUniform2f(offsetLocation, 0.0f, 0.0f);
+    glBindVertexArray(0);
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,125 @@
+// ==========================================================================
+// Glyph Ticker
+//
+// A single line of text that scrolls right to left forever, fed from a
+// stream. The glyphs on screen live in a fixed ring of slots, each a fixed
+// range of one vertex buffer. When a glyph scrolls off the left edge its
+// slot is recycled, and a glyph is only extracted and uploaded (into its
+// slot, with glBufferSubData) when it is about to come in from the right.
+// Buffer memory and upload bandwidth therefore stay the same no matter how
+// long the ticker runs. Each slot is drawn with the vertex shader's offset
+// uniform, so scrolling itself never touches the buffers.
+//
+// An OpenGL context must be current whenever the ticker is used or destroyed.
+// ==========================================================================
+#ifndef GLYPHTICKER_H
+#define GLYPHTICKER_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <glad/include/glad/glad.h>
+#include <glm-0.9.8.2/glm/glm.hpp>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+
+class GlyphTicker
+{
+    // a glyph on screen: its character, its pen position and advance along
+    // the ticker in EM units, and how many vertices of its slot it uses
+    struct Slot
+    {
+        int     character;
+        float   x, advance;
+        GLsizei count;
+    };
+
+    GLuint m_vertexBuffer, m_colourBuffer, m_vertexArray;
+
+    // the ring: m_used slots starting at m_head, oldest (leftmost) first
+    std::vector<Slot> m_slots;
+    unsigned int m_slotVertices;
+    unsigned int m_head, m_used;
+
+    // characters waiting to come in from the right, and how many may wait
+    std::deque<int> m_queue;
+    size_t m_queueLimit;
+
+    // how far the ticker has scrolled, and where the next glyph goes, in EM
+    // units; both are brought back towards zero now and then so they keep
+    // their precision
+    float m_scroll, m_pen;
+    int   m_previous;
+
+    // set when a glyph was due but no text had arrived, so the next one
+    // comes in at the right edge rather than where the text left off
+    bool  m_starved;
+
+    // what the slots were built with
+    std::string m_font;
+    int   m_patchSize;
+    float m_scale;
+    glm::vec3 m_colour;
+
+    // patch data for the glyph being uploaded
+    std::vector<glm::vec2> m_vertices;
+    std::vector<glm::vec3> m_colours;
+
+    unsigned long m_uploads;
+    size_t m_bytesUploaded;
+
+    // builds a glyph's patches and writes them into a slot
+    void Upload(GlyphExtractor &extractor, unsigned int slot);
+
+    // rebuilds every glyph on screen, after the font or patch size changes
+    void Rebuild(GlyphExtractor &extractor);
+
+    GlyphTicker(const GlyphTicker &);
+    GlyphTicker &operator=(const GlyphTicker &);
+
+public:
+    // slots is how many glyphs can be on screen at once, and slotVertices
+    // the most patch vertices one glyph may have; the buffers are sized
+    // from these once. scale takes EM units to clip coordinates.
+    GlyphTicker(float scale, unsigned int slots = 128, unsigned int slotVertices = 1024);
+    ~GlyphTicker();
+
+    // creates the buffers; returns false on an OpenGL error
+    bool Initialize();
+
+    // deletes the buffers; call before the context goes away if the ticker
+    // outlives it
+    void Destroy();
+
+    // whether there is room to queue more text
+    bool WantsText() const      { return m_queue.size() < m_queueLimit; }
+
+    // queues characters to scroll in after those already queued; line
+    // breaks and tabs become spaces and other control characters are dropped
+    void Push(const int *characters, size_t count);
+
+    // scrolls by distance EM units in a view viewWidth EM units wide,
+    // recycling the slots of glyphs that went off the left edge and
+    // uploading glyphs that come in at the right; the font is made the
+    // extractor's current one
+    void Advance(GlyphExtractor &extractor, const std::string &font,
+                 int patchSize, float distance, float viewWidth);
+
+    // draws the glyphs on screen with the left edge of the view at origin,
+    // in clip coordinates
+    void Draw(GLuint program, const glm::vec2 &origin) const;
+
+    // statistics
+    unsigned int SlotsInUse() const         { return m_used; }
+    size_t QueuedCharacters() const         { return m_queue.size(); }
+    unsigned long GlyphsUploaded() const    { return m_uploads; }
+    size_t BytesUploaded() const            { return m_bytesUploaded; }
+    size_t BufferBytes() const
+    { return m_slots.size() * m_slotVertices * (sizeof(glm::vec2) + sizeof(glm::vec3)); }
+};
+
+// --------------------------------------------------------------------------
+#endif // GLYPHTICKER_H
@@ -0,0 +1,122 @@
+// ==========================================================================
+// Kerning Pair Table
+//
+// Every kerning pair of a face, read once when the font is loaded. Faces
+// with a plain 'kern' table (format 0 subtables, as in most TrueType and
+// many OpenType fonts) have their pairs copied into a hash table keyed by
+// the two glyph indices, so a lookup is a single probe rather than a search
+// through the font data. Faces whose kerning FreeType can read but this
+// module cannot parse fall back to FT_Get_Kerning for each lookup.
+// ==========================================================================
+
+#include "KerningTable.h"
+#include <vector>
+
+#include FT_TRUETYPE_TABLES_H
+#include FT_TRUETYPE_TAGS_H
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+// big-endian reads from the table data
+static unsigned int ReadU16(const unsigned char *p)
+{
+    return p[0] << 8 | p[1];
+}
+
+static short ReadS16(const unsigned char *p)
+{
+    return short(ReadU16(p));
+}
+
+// coverage bits of a version 0 subtable
+static const unsigned int COVERAGE_HORIZONTAL = 0x1;
+static const unsigned int COVERAGE_MINIMUM = 0x2;
+static const unsigned int COVERAGE_CROSS_STREAM = 0x4;
+static const unsigned int COVERAGE_OVERRIDE = 0x8;
+
+// --------------------------------------------------------------------------
+
+KerningTable::KerningTable()
+    : m_fallback(false)
+{}
+
+void KerningTable::Build(FT_Face face)
+{
+    m_pairs.clear();
+    m_fallback = false;
+
+    if (!FT_HAS_KERNING(face))
+        return;
+    if (!ReadKernTable(face)) {
+        m_pairs.clear();
+        m_fallback = true;
+    }
+}
+
+bool KerningTable::ReadKernTable(FT_Face face)
+{
+    FT_ULong length = 0;
+    if (FT_Load_Sfnt_Table(face, TTAG_kern, 0, 0, &length) || length < 4)
+        return false;
+
+    vector<unsigned char> table(length);
+    if (FT_Load_Sfnt_Table(face, TTAG_kern, 0, &table[0], &length))
+        return false;
+
+    // only the Microsoft layout: a 16-bit version 0 and subtable count
+    const unsigned char *data = &table[0];
+    if (ReadU16(data) != 0)
+        return false;
+    unsigned int subtables = ReadU16(data + 2);
+
+    size_t offset = 4;
+    for (unsigned int t = 0; t < subtables; ++t)
+    {
+        if (offset + 6 > length)
+            return false;
+        const unsigned char *header = data + offset;
+        unsigned int subtableLength = ReadU16(header + 2);
+        unsigned int coverage = ReadU16(header + 4);
+        unsigned int format = coverage >> 8;
+
+        // the same subtables FreeType itself applies: horizontal kerning
+        // values, in format 0
+        bool used = format == 0 && (coverage & COVERAGE_HORIZONTAL) &&
+                    !(coverage & (COVERAGE_MINIMUM | COVERAGE_CROSS_STREAM));
+        if (used && offset + 14 <= length)
+        {
+            // like FreeType, read only the pairs that fit in the table
+            unsigned int pairs = ReadU16(header + 6);
+            const unsigned char *pair = header + 14;
+            if (size_t(pairs) * 6 > length - offset - 14)
+                pairs = (length - offset - 14) / 6;
+
+            for (unsigned int p = 0; p < pairs; ++p, pair += 6)
+            {
+                unsigned int key = ReadU16(pair) << 16 | ReadU16(pair + 2);
+                short value = ReadS16(pair + 4);
+                if (coverage & COVERAGE_OVERRIDE)
+                    m_pairs[key] = value;
+                else
+                    m_pairs[key] += value;
+            }
+        }
+
+        // some fonts store a single large subtable whose 16-bit length has
+        // wrapped around; its pairs run to the end of the table
+        if (subtableLength < 6 || t + 1 == subtables)
+            break;
+        offset += subtableLength;
+    }
+
+    // pairs that cancel out need not be stored
+    for (unordered_map<unsigned int, short>::iterator it = m_pairs.begin(); it != m_pairs.end(); ) {
+        if (it->second == 0) it = m_pairs.erase(it);
+        else ++it;
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------
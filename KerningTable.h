@@ -0,0 +1,62 @@
+// ==========================================================================
+// Kerning Pair Table
+//
+// Every kerning pair of a face, read once when the font is loaded. Faces
+// with a plain 'kern' table (format 0 subtables, as in most TrueType and
+// many OpenType fonts) have their pairs copied into a hash table keyed by
+// the two glyph indices, so a lookup is a single probe rather than a search
+// through the font data. Faces whose kerning FreeType can read but this
+// module cannot parse fall back to FT_Get_Kerning for each lookup.
+// ==========================================================================
+#ifndef KERNINGTABLE_H
+#define KERNINGTABLE_H
+
+#include <unordered_map>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+// --------------------------------------------------------------------------
+
+class KerningTable
+{
+    // adjustments in font units, keyed by (left << 16 | right) glyph index
+    std::unordered_map<unsigned int, short> m_pairs;
+
+    // set when the pairs have to be asked of FreeType instead
+    bool m_fallback;
+
+    // reads the face's 'kern' table; false if it is not in a known format
+    bool ReadKernTable(FT_Face face);
+
+public:
+    KerningTable();
+
+    // reads the kerning pairs of the face, if it has any
+    void Build(FT_Face face);
+
+    // kerning between two glyphs, in font units
+    int Kerning(FT_Face face, unsigned int left, unsigned int right) const
+    {
+        if (m_fallback) {
+            FT_Vector kerning;
+            if (FT_Get_Kerning(face, left, right, FT_KERNING_UNSCALED, &kerning))
+                return 0;
+            return kerning.x;
+        }
+        if (m_pairs.empty() || left > 0xFFFF || right > 0xFFFF) return 0;
+        std::unordered_map<unsigned int, short>::const_iterator it =
+            m_pairs.find(left << 16 | right);
+        return it != m_pairs.end() ? it->second : 0;
+    }
+
+    size_t PairCount() const    { return m_pairs.size(); }
+
+    // every pair read from the face, keyed as above; empty when the pairs
+    // are asked of FreeType, which can't list them
+    const std::unordered_map<unsigned int, short> &Pairs() const    { return m_pairs; }
+    bool UsesFreeType() const   { return m_fallback; }
+};
+
+// --------------------------------------------------------------------------
+#endif // KERNINGTABLE_H
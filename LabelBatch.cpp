@@ -0,0 +1,358 @@
+// ==========================================================================
+// Label Batch
+//
+// Draws thousands of short labels that each move on their own. Every
+// distinct character's patches are built once, in EM units, into one
+// shared vertex buffer; a label is just a list of glyph instances (which
+// character, and its pen position within the label) plus a transform, its
+// position and scale. Transforms live in a buffer texture the label vertex
+// shader reads, so moving a label rewrites its 16 bytes and nothing else.
+//
+// Instances are sorted by character and each character is drawn with one
+// instanced draw call, so the number of draw calls is the number of
+// distinct characters, not of labels or glyphs. Instances are only sorted
+// again when labels are added or removed.
+// ==========================================================================
+
+#include "LabelBatch.h"
+#include "TextGeometry.h"
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+
+static const GLuint VERTEX_INDEX = 0;
+static const GLuint COLOUR_INDEX = 1;
+static const GLuint PEN_INDEX = 2;
+static const GLuint LABEL_INDEX = 3;
+
+LabelBatch::LabelBatch()
+    : m_transformCapacity(0), m_atlasUploaded(0), m_atlasCapacity(0),
+      m_instancesChanged(false), m_layoutChanged(false),
+      m_vertexBuffer(0), m_colourBuffer(0), m_instanceBuffer(0), m_vertexArray(0),
+      m_transformBuffer(0), m_transformTexture(0),
+      m_patchSize(0), m_colour(1.0f, 1.0f, 1.0f), m_transformsUploaded(0)
+{}
+
+LabelBatch::~LabelBatch()
+{
+    Destroy();
+}
+
+bool LabelBatch::Initialize()
+{
+    glGenBuffers(1, &m_vertexBuffer);
+    glGenBuffers(1, &m_colourBuffer);
+    glGenBuffers(1, &m_instanceBuffer);
+    glGenBuffers(1, &m_transformBuffer);
+    glGenVertexArrays(1, &m_vertexArray);
+    glBindVertexArray(m_vertexArray);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glVertexAttribPointer(VERTEX_INDEX, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+    glEnableVertexAttribArray(VERTEX_INDEX);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_colourBuffer);
+    glVertexAttribPointer(COLOUR_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), 0);
+    glEnableVertexAttribArray(COLOUR_INDEX);
+
+    // the instance attributes advance once per glyph drawn rather than per
+    // vertex; Draw points them at each character's instances in turn
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    glVertexAttribPointer(PEN_INDEX, 2, GL_FLOAT, GL_FALSE, sizeof(Instance), 0);
+    glVertexAttribIPointer(LABEL_INDEX, 1, GL_UNSIGNED_INT, sizeof(Instance),
+                           (const void *)offsetof(Instance, label));
+    glVertexAttribDivisor(PEN_INDEX, 1);
+    glVertexAttribDivisor(LABEL_INDEX, 1);
+    glEnableVertexAttribArray(PEN_INDEX);
+    glEnableVertexAttribArray(LABEL_INDEX);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, m_transformBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(vec4), 0, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    m_transformCapacity = 1;
+
+    glGenTextures(1, &m_transformTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, m_transformTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_transformBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+void LabelBatch::Destroy()
+{
+    if (!m_vertexArray)
+        return;
+
+    glDeleteTextures(1, &m_transformTexture);
+    glDeleteVertexArrays(1, &m_vertexArray);
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_colourBuffer);
+    glDeleteBuffers(1, &m_instanceBuffer);
+    glDeleteBuffers(1, &m_transformBuffer);
+    m_transformTexture = m_vertexArray = 0;
+    m_vertexBuffer = m_colourBuffer = m_instanceBuffer = m_transformBuffer = 0;
+
+    // everything is uploaded again if the batch is initialized again
+    m_atlasUploaded = m_atlasCapacity = 0;
+    m_transformCapacity = 0;
+    m_instancesChanged = true;
+}
+
+// --------------------------------------------------------------------------
+
+unsigned int LabelBatch::AddLabel(const string &text, const vec2 &position, float scale)
+{
+    unsigned int label;
+    if (!m_freeLabels.empty()) {
+        label = m_freeLabels.back();
+        m_freeLabels.pop_back();
+    }
+    else {
+        label = m_labels.size();
+        m_labels.push_back(Label());
+        m_transforms.push_back(vec4());
+        m_isMoved.push_back(false);
+    }
+
+    Label &l = m_labels[label];
+    l.text = text;
+    l.glyphs.clear();
+    l.live = true;
+    l.laidOut = false;
+    m_layoutChanged = true;
+
+    MoveLabel(label, position, scale);
+    return label;
+}
+
+void LabelBatch::RemoveLabel(unsigned int label)
+{
+    Label &l = m_labels[label];
+    if (!l.live)
+        return;
+
+    l.live = false;
+    l.text.clear();
+    l.glyphs.clear();
+    m_freeLabels.push_back(label);
+    m_instancesChanged = true;
+}
+
+void LabelBatch::MoveLabel(unsigned int label, const vec2 &position, float scale)
+{
+    m_transforms[label] = vec4(position.x, position.y, scale, 0.0f);
+    if (!m_isMoved[label]) {
+        m_isMoved[label] = true;
+        m_moved.push_back(label);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void LabelBatch::AddToAtlas(GlyphExtractor &extractor, int character)
+{
+    if (m_atlas.count(character))
+        return;
+
+    // glyphs are built at the origin and at EM size; labels place and
+    // scale them in the vertex shader
+    GlyphRange &range = m_atlas[character];
+    range.first = m_atlasVertices.size();
+    AppendGlyphPatches(extractor.CachedOutline(character), 0.0f, 0.0f, 1.0f,
+                       m_patchSize, m_colour, m_atlasVertices, m_atlasColours);
+    range.count = m_atlasVertices.size() - range.first;
+}
+
+void LabelBatch::UploadAtlas()
+{
+    size_t size = m_atlasVertices.size();
+
+    // the buffers double when they fill up, so adding characters one at a
+    // time costs no more than building them all at once
+    if (size > m_atlasCapacity) {
+        m_atlasCapacity = max(size, 2 * m_atlasCapacity);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * m_atlasCapacity, 0, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, m_colourBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * m_atlasCapacity, 0, GL_STATIC_DRAW);
+        m_atlasUploaded = 0;
+    }
+
+    size_t count = size - m_atlasUploaded;
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(vec2) * m_atlasUploaded, sizeof(vec2) * count,
+                    &m_atlasVertices[m_atlasUploaded]);
+    glBindBuffer(GL_ARRAY_BUFFER, m_colourBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(vec3) * m_atlasUploaded, sizeof(vec3) * count,
+                    &m_atlasColours[m_atlasUploaded]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_atlasUploaded = size;
+}
+
+void LabelBatch::SortInstances()
+{
+    // (character, instance) pairs of every glyph that has an outline
+    vector<pair<int, Instance> > glyphs;
+    for (unsigned int label = 0; label < m_labels.size(); ++label)
+    {
+        const Label &l = m_labels[label];
+        if (!l.live) continue;
+        for (size_t i = 0; i < l.glyphs.size(); ++i)
+        {
+            const PlacedGlyph &g = l.glyphs[i];
+            if (m_atlas[g.character].count == 0) continue;
+
+            Instance instance;
+            instance.pen = vec2(g.x, g.y);
+            instance.label = label;
+            glyphs.push_back(make_pair(g.character, instance));
+        }
+    }
+
+    struct ByCharacter
+    {
+        bool operator()(const pair<int, Instance> &a, const pair<int, Instance> &b) const
+        { return a.first < b.first; }
+    };
+    sort(glyphs.begin(), glyphs.end(), ByCharacter());
+
+    m_instances.resize(glyphs.size());
+    m_draws.clear();
+    for (size_t i = 0; i < glyphs.size(); ++i)
+    {
+        m_instances[i] = glyphs[i].second;
+        if (i == 0 || glyphs[i].first != glyphs[i - 1].first) {
+            CharacterDraw draw;
+            draw.glyph = m_atlas[glyphs[i].first];
+            draw.first = i;
+            draw.count = 0;
+            m_draws.push_back(draw);
+        }
+        ++m_draws.back().count;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Instance) * m_instances.size(),
+                 m_instances.empty() ? 0 : &m_instances[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_instancesChanged = false;
+}
+
+void LabelBatch::UploadTransforms()
+{
+    glBindBuffer(GL_TEXTURE_BUFFER, m_transformBuffer);
+
+    if (m_transforms.size() > m_transformCapacity)
+    {
+        // grown: everything is uploaded, moved or not
+        m_transformCapacity = max(m_transforms.size(), 2 * m_transformCapacity);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(vec4) * m_transformCapacity, 0, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(vec4) * m_transforms.size(), &m_transforms[0]);
+        m_transformsUploaded += m_transforms.size();
+    }
+    else
+    {
+        // labels moved in runs of neighbouring ids are uploaded together
+        sort(m_moved.begin(), m_moved.end());
+        for (size_t i = 0; i < m_moved.size(); )
+        {
+            size_t j = i + 1;
+            while (j < m_moved.size() && m_moved[j] == m_moved[j - 1] + 1) ++j;
+            glBufferSubData(GL_TEXTURE_BUFFER, sizeof(vec4) * m_moved[i],
+                            sizeof(vec4) * (j - i), &m_transforms[m_moved[i]]);
+            i = j;
+        }
+        m_transformsUploaded += m_moved.size();
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    for (size_t i = 0; i < m_moved.size(); ++i)
+        m_isMoved[m_moved[i]] = false;
+    m_moved.clear();
+}
+
+void LabelBatch::Update(GlyphExtractor &extractor, const string &font, int patchSize)
+{
+    if (!m_vertexArray) {
+        cout << "LabelBatch ERROR: Update before Initialize" << endl;
+        return;
+    }
+
+    extractor.LoadFontFile(font);
+    if (font != m_font || patchSize != m_patchSize)
+    {
+        m_font = font;
+        m_patchSize = patchSize;
+        m_atlas.clear();
+        m_atlasVertices.clear();
+        m_atlasColours.clear();
+        m_atlasUploaded = 0;
+        for (size_t i = 0; i < m_labels.size(); ++i)
+            m_labels[i].laidOut = false;
+        m_layoutChanged = true;
+    }
+
+    if (m_layoutChanged)
+    {
+        for (size_t i = 0; i < m_labels.size(); ++i)
+        {
+            Label &l = m_labels[i];
+            if (!l.live || l.laidOut) continue;
+
+            m_layout.LayoutLine(extractor, l.text);
+            l.glyphs = m_layout.Glyphs();
+            for (size_t g = 0; g < l.glyphs.size(); ++g)
+                AddToAtlas(extractor, l.glyphs[g].character);
+            l.laidOut = true;
+        }
+        m_layoutChanged = false;
+        m_instancesChanged = true;
+    }
+
+    if (m_atlasUploaded < m_atlasVertices.size())
+        UploadAtlas();
+    if (m_instancesChanged)
+        SortInstances();
+    if (!m_moved.empty() || m_transforms.size() > m_transformCapacity)
+        UploadTransforms();
+}
+
+// --------------------------------------------------------------------------
+
+void LabelBatch::Draw(GLuint program) const
+{
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, m_transformTexture);
+    glUniform1i(glGetUniformLocation(program, "labelTransforms"), 0);
+
+    glBindVertexArray(m_vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+
+    for (size_t i = 0; i < m_draws.size(); ++i)
+    {
+        // without a base instance (OpenGL 4.2), each character's instances
+        // are reached by moving the instance attributes to them
+        const CharacterDraw &draw = m_draws[i];
+        size_t offset = draw.first * sizeof(Instance);
+        glVertexAttribPointer(PEN_INDEX, 2, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                              (const void *)offset);
+        glVertexAttribIPointer(LABEL_INDEX, 1, GL_UNSIGNED_INT, sizeof(Instance),
+                               (const void *)(offset + offsetof(Instance, label)));
+        glDrawArraysInstanced(GL_PATCHES, draw.glyph.first, draw.glyph.count, draw.count);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,141 @@
+// ==========================================================================
+// Label Batch
+//
+// Draws thousands of short labels that each move on their own. Every
+// distinct character's patches are built once, in EM units, into one
+// shared vertex buffer; a label is just a list of glyph instances (which
+// character, and its pen position within the label) plus a transform, its
+// position and scale. Transforms live in a buffer texture the label vertex
+// shader reads, so moving a label rewrites its 16 bytes and nothing else.
+//
+// Instances are sorted by character and each character is drawn with one
+// instanced draw call, so the number of draw calls is the number of
+// distinct characters, not of labels or glyphs. Instances are only sorted
+// again when labels are added or removed.
+//
+// Draw with the program built from labelVertex.glsl. An OpenGL context must
+// be current whenever the batch is updated, drawn or destroyed.
+// ==========================================================================
+#ifndef LABELBATCH_H
+#define LABELBATCH_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/include/glad/glad.h>
+#include <glm-0.9.8.2/glm/glm.hpp>
+
+#include "GlyphExtractor.h"
+#include "TextLayout.h"
+
+// --------------------------------------------------------------------------
+
+class LabelBatch
+{
+    // a character's patches within the shared glyph buffer
+    struct GlyphRange
+    {
+        GLint   first;
+        GLsizei count;
+    };
+
+    // a glyph of a label, as the label vertex shader reads it per instance
+    struct Instance
+    {
+        glm::vec2    pen;
+        unsigned int label;
+    };
+
+    // the instances of one character, a range of the sorted instance
+    // buffer, and the character's patches they are drawn with
+    struct CharacterDraw
+    {
+        GlyphRange glyph;
+        unsigned int first, count;
+    };
+
+    struct Label
+    {
+        std::string text;
+        std::vector<PlacedGlyph> glyphs;
+        bool live, laidOut;
+    };
+
+    std::vector<Label> m_labels;
+    std::vector<unsigned int> m_freeLabels;
+
+    // position and scale of every label, one texel each: x, y, scale, 0
+    std::vector<glm::vec4> m_transforms;
+    std::vector<unsigned int> m_moved;
+    std::vector<bool> m_isMoved;
+    size_t m_transformCapacity;
+
+    // the shared glyph buffer and what it holds
+    std::unordered_map<int, GlyphRange> m_atlas;
+    std::vector<glm::vec2> m_atlasVertices;
+    std::vector<glm::vec3> m_atlasColours;
+    size_t m_atlasUploaded, m_atlasCapacity;
+
+    std::vector<Instance> m_instances;
+    std::vector<CharacterDraw> m_draws;
+    bool m_instancesChanged, m_layoutChanged;
+
+    GLuint m_vertexBuffer, m_colourBuffer, m_instanceBuffer, m_vertexArray;
+    GLuint m_transformBuffer, m_transformTexture;
+
+    // what the glyph buffer was built with
+    std::string m_font;
+    int m_patchSize;
+    glm::vec3 m_colour;
+
+    TextLayout m_layout;
+
+    unsigned long m_transformsUploaded;
+
+    void AddToAtlas(GlyphExtractor &extractor, int character);
+    void UploadAtlas();
+    void SortInstances();
+    void UploadTransforms();
+
+    LabelBatch(const LabelBatch &);
+    LabelBatch &operator=(const LabelBatch &);
+
+public:
+    LabelBatch();
+    ~LabelBatch();
+
+    // creates the buffers; returns false on an OpenGL error
+    bool Initialize();
+    void Destroy();
+
+    // adds a label with its pen starting at position, in clip coordinates,
+    // and scale taking EM units to clip coordinates; returns its id, which
+    // stays the same until it is removed
+    unsigned int AddLabel(const std::string &text, const glm::vec2 &position, float scale);
+    void RemoveLabel(unsigned int label);
+
+    // moves a label; only labels moved since the last Update are uploaded
+    void MoveLabel(unsigned int label, const glm::vec2 &position, float scale);
+    void MoveLabel(unsigned int label, const glm::vec2 &position)
+    { MoveLabel(label, position, m_transforms[label].z); }
+    glm::vec2 LabelPosition(unsigned int label) const
+    { return glm::vec2(m_transforms[label].x, m_transforms[label].y); }
+
+    // brings the buffers up to date: lays out and adds the glyphs of new
+    // labels, rebuilding everything if the font or patch size changed, and
+    // uploads the transforms of the labels that moved
+    void Update(GlyphExtractor &extractor, const std::string &font, int patchSize);
+
+    // draws every label, one instanced draw call per distinct character
+    void Draw(GLuint program) const;
+
+    // statistics
+    size_t LabelCount() const               { return m_labels.size() - m_freeLabels.size(); }
+    size_t GlyphCount() const               { return m_instances.size(); }
+    size_t DrawCalls() const                { return m_draws.size(); }
+    unsigned long TransformsUploaded() const { return m_transformsUploaded; }
+};
+
+// --------------------------------------------------------------------------
+#endif // LABELBATCH_H
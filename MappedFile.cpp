@@ -0,0 +1,89 @@
+// ==========================================================================
+// Read-only Memory-Mapped Files
+//
+// This module maps a file into memory read-only with mmap. Mappings are
+// shared: opening the same file again, from any thread, returns the mapping
+// that already exists, and the file is unmapped once the last handle to it
+// is released. Font faces opened over a mapping hold a handle to it so the
+// bytes stay valid for as long as the face does.
+// ==========================================================================
+
+#include "MappedFile.h"
+#include <iostream>
+#include <map>
+#include <mutex>
+
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+// mappings currently alive, keyed by canonical path
+static mutex s_mappingsLock;
+static map<string, weak_ptr<MappedFile> > s_mappings;
+
+MappedFile::~MappedFile()
+{
+    if (m_data) munmap((void *)m_data, m_size);
+}
+
+// deleter for mappings: drops the file's entry, unless it has been mapped
+// again in the meantime, so entries don't pile up for files no longer open
+static void ReleaseMapping(MappedFile *file)
+{
+    {
+        lock_guard<mutex> lock(s_mappingsLock);
+        map<string, weak_ptr<MappedFile> >::iterator found = s_mappings.find(file->Filename());
+        if (found != s_mappings.end() && found->second.expired())
+            s_mappings.erase(found);
+    }
+    delete file;
+}
+
+// --------------------------------------------------------------------------
+
+shared_ptr<MappedFile> MappedFile::Open(const string &filename)
+{
+    // different spellings of the same path should share one mapping
+    char resolved[PATH_MAX];
+    string key = realpath(filename.c_str(), resolved) ? string(resolved) : filename;
+
+    lock_guard<mutex> lock(s_mappingsLock);
+
+    shared_ptr<MappedFile> mapping;
+    map<string, weak_ptr<MappedFile> >::iterator found = s_mappings.find(key);
+    if (found != s_mappings.end() && (mapping = found->second.lock()))
+        return mapping;
+
+    int fd = open(key.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cout << "MappedFile ERROR: could not open " << filename << endl;
+        return mapping;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        cout << "MappedFile ERROR: could not read size of " << filename << endl;
+        close(fd);
+        return mapping;
+    }
+
+    void *data = mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        cout << "MappedFile ERROR: could not map " << filename << endl;
+        return mapping;
+    }
+
+    mapping.reset(new MappedFile((const unsigned char *)data, info.st_size, key), ReleaseMapping);
+    s_mappings[key] = mapping;
+    return mapping;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,47 @@
+// ==========================================================================
+// Read-only Memory-Mapped Files
+//
+// This module maps a file into memory read-only with mmap. Mappings are
+// shared: opening the same file again, from any thread, returns the mapping
+// that already exists, and the file is unmapped once the last handle to it
+// is released. Font faces opened over a mapping hold a handle to it so the
+// bytes stay valid for as long as the face does.
+// ==========================================================================
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// --------------------------------------------------------------------------
+
+class MappedFile
+{
+    const unsigned char *m_data;
+    size_t               m_size;
+    std::string          m_filename;
+
+    MappedFile(const unsigned char *data, size_t size, const std::string &filename)
+        : m_data(data), m_size(size), m_filename(filename)
+    {}
+
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+public:
+    ~MappedFile();
+
+    const unsigned char *Data() const       { return m_data; }
+    size_t Size() const                     { return m_size; }
+    const std::string &Filename() const     { return m_filename; }
+
+    // returns the shared mapping for the given file, mapping it if no one
+    // holds it yet; returns an empty pointer if the file can't be mapped
+    static std::shared_ptr<MappedFile> Open(const std::string &filename);
+};
+
+typedef std::shared_ptr<MappedFile> MappedFileHandle;
+
+// --------------------------------------------------------------------------
+#endif // MAPPEDFILE_H
@@ -0,0 +1,62 @@
+// ==========================================================================
+// Outline Arena
+//
+// A simple bump allocator for glyph outline data. Memory is taken from large
+// blocks and is only given back all at once, by Reset() or destruction, so
+// outlines built in the arena cost no per-contour heap allocations and sit
+// next to each other in memory. Only trivially destructible types (segments,
+// spans) should be stored here, as no destructors are run.
+// ==========================================================================
+
+#include "OutlineArena.h"
+#include <cstdlib>
+
+using namespace std;
+
+// allocations are rounded up to this, which suits every type we store
+static const size_t ALIGNMENT = 16;
+
+// --------------------------------------------------------------------------
+
+OutlineArena::OutlineArena(size_t blockSize)
+    : m_blockSize(blockSize), m_used(0), m_capacity(0), m_allocated(0), m_reserved(0)
+{}
+
+OutlineArena::~OutlineArena()
+{
+    Reset();
+}
+
+// --------------------------------------------------------------------------
+
+void *OutlineArena::Allocate(size_t bytes)
+{
+    bytes = (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+    if (m_blocks.empty() || m_used + bytes > m_capacity)
+    {
+        // requests larger than a block get a block of their own
+        size_t capacity = bytes > m_blockSize ? bytes : m_blockSize;
+        char *block = static_cast<char *>(malloc(capacity));
+        if (!block) return 0;
+        m_blocks.push_back(block);
+        m_used = 0;
+        m_capacity = capacity;
+        m_reserved += capacity;
+    }
+
+    void *p = m_blocks.back() + m_used;
+    m_used += bytes;
+    m_allocated += bytes;
+    return p;
+}
+
+void OutlineArena::Reset()
+{
+    for (size_t i = 0; i < m_blocks.size(); ++i)
+        free(m_blocks[i]);
+    m_blocks.clear();
+    m_used = m_capacity = m_allocated = m_reserved = 0;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,50 @@
+// ==========================================================================
+// Outline Arena
+//
+// A simple bump allocator for glyph outline data. Memory is taken from large
+// blocks and is only given back all at once, by Reset() or destruction, so
+// outlines built in the arena cost no per-contour heap allocations and sit
+// next to each other in memory. Only trivially destructible types (segments,
+// spans) should be stored here, as no destructors are run.
+// ==========================================================================
+#ifndef OUTLINEARENA_H
+#define OUTLINEARENA_H
+
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------------------------
+
+class OutlineArena
+{
+    // blocks of raw storage, and how much of the last block is in use
+    std::vector<char *> m_blocks;
+    size_t m_blockSize, m_used, m_capacity;
+
+    // total bytes handed out and taken from the heap, for statistics
+    size_t m_allocated, m_reserved;
+
+    OutlineArena(const OutlineArena &);
+    OutlineArena &operator=(const OutlineArena &);
+
+public:
+    OutlineArena(size_t blockSize = 64 * 1024);
+    ~OutlineArena();
+
+    // returns storage for the given number of bytes, aligned for any type,
+    // or null if no memory is left
+    void *Allocate(size_t bytes);
+
+    // typed helper that returns storage for count objects of type T
+    template <class T>
+    T *Allocate(size_t count)   { return static_cast<T *>(Allocate(count * sizeof(T))); }
+
+    // releases all memory handed out by this arena
+    void Reset();
+
+    size_t BytesAllocated() const   { return m_allocated; }
+    size_t BytesReserved() const    { return m_reserved; }
+};
+
+// --------------------------------------------------------------------------
+#endif // OUTLINEARENA_H
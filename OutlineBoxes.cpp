@@ -0,0 +1,133 @@
+// ==========================================================================
+// Outline Boxes
+//
+// Finds the curve segment of a glyph outline under a point. The control
+// points of a Bezier segment bound the curve, so each segment's box is
+// taken from them; a point is only measured against the few segments whose
+// boxes, grown by the tolerance, hold it. Boxes are built once per
+// character, the first time it is tested, and kept until Clear.
+// ==========================================================================
+
+#include "OutlineBoxes.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+// points along a curved segment its distance is measured between
+static const int DISTANCE_STEPS = 16;
+
+// evaluates a Bezier segment of degree 1 to 3 at t
+static void Evaluate(const MySegment &s, float t, float &x, float &y)
+{
+    float u = 1.0f - t;
+    switch (s.degree)
+    {
+    case 3:
+        x = u*u*u*s.x[0] + 3*u*u*t*s.x[1] + 3*u*t*t*s.x[2] + t*t*t*s.x[3];
+        y = u*u*u*s.y[0] + 3*u*u*t*s.y[1] + 3*u*t*t*s.y[2] + t*t*t*s.y[3];
+        break;
+    case 2:
+        x = u*u*s.x[0] + 2*u*t*s.x[1] + t*t*s.x[2];
+        y = u*u*s.y[0] + 2*u*t*s.y[1] + t*t*s.y[2];
+        break;
+    default:
+        x = u*s.x[0] + t*s.x[s.degree];
+        y = u*s.y[0] + t*s.y[s.degree];
+        break;
+    }
+}
+
+// distance from a point to the line segment from a to b
+static float SegmentDistance(float px, float py, float ax, float ay, float bx, float by)
+{
+    float dx = bx - ax, dy = by - ay;
+    float length = dx*dx + dy*dy;
+    float t = length > 0 ? ((px - ax)*dx + (py - ay)*dy) / length : 0;
+    t = max(0.0f, min(t, 1.0f));
+    float ex = ax + t*dx - px, ey = ay + t*dy - py;
+    return sqrt(ex*ex + ey*ey);
+}
+
+// distance from a point to a segment: exact for lines, and to a polyline
+// through the curve for curves
+static float Distance(const MySegment &s, float x, float y)
+{
+    if (s.degree <= 1)
+        return SegmentDistance(x, y, s.x[0], s.y[0], s.x[s.degree], s.y[s.degree]);
+
+    float distance = INFINITY;
+    float ax = s.x[0], ay = s.y[0];
+    for (int i = 1; i <= DISTANCE_STEPS; ++i)
+    {
+        float bx, by;
+        Evaluate(s, float(i) / DISTANCE_STEPS, bx, by);
+        distance = min(distance, SegmentDistance(x, y, ax, ay, bx, by));
+        ax = bx;
+        ay = by;
+    }
+    return distance;
+}
+
+// --------------------------------------------------------------------------
+
+const vector<OutlineBoxes::SegmentBox> &OutlineBoxes::Boxes(GlyphExtractor &extractor, int character)
+{
+    unordered_map<int, vector<SegmentBox> >::iterator found = m_boxes.find(character);
+    if (found != m_boxes.end())
+        return found->second;
+
+    vector<SegmentBox> &boxes = m_boxes[character];
+    const MyOutline &outline = extractor.CachedOutline(character);
+    for (unsigned int c = 0; c < outline.contourCount; ++c)
+    {
+        const MySegment *begin = outline.ContourBegin(c);
+        for (const MySegment *s = begin; s != outline.ContourEnd(c); ++s)
+        {
+            SegmentBox box;
+            box.xMin = box.xMax = s->x[0];
+            box.yMin = box.yMax = s->y[0];
+            for (unsigned int i = 1; i <= s->degree; ++i) {
+                box.xMin = min(box.xMin, s->x[i]);
+                box.xMax = max(box.xMax, s->x[i]);
+                box.yMin = min(box.yMin, s->y[i]);
+                box.yMax = max(box.yMax, s->y[i]);
+            }
+            box.contour = c;
+            box.segment = s - begin;
+            boxes.push_back(box);
+        }
+    }
+    return boxes;
+}
+
+bool OutlineBoxes::SegmentAt(GlyphExtractor &extractor, int character, float x, float y,
+                             float tolerance, SegmentHit &hit)
+{
+    const vector<SegmentBox> &boxes = Boxes(extractor, character);
+    const MyOutline &outline = extractor.CachedOutline(character);
+
+    bool found = false;
+    hit.distance = tolerance;
+    for (size_t i = 0; i < boxes.size(); ++i)
+    {
+        const SegmentBox &box = boxes[i];
+        if (x < box.xMin - tolerance || x > box.xMax + tolerance ||
+            y < box.yMin - tolerance || y > box.yMax + tolerance)
+            continue;
+
+        const MySegment &segment = outline.ContourBegin(box.contour)[box.segment];
+        float distance = Distance(segment, x, y);
+        if (distance <= hit.distance) {
+            hit.contour = box.contour;
+            hit.segment = box.segment;
+            hit.distance = distance;
+            found = true;
+        }
+    }
+    return found;
+}
+
+// --------------------------------------------------------------------------
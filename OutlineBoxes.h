@@ -0,0 +1,59 @@
+// ==========================================================================
+// Outline Boxes
+//
+// Finds the curve segment of a glyph outline under a point. The control
+// points of a Bezier segment bound the curve, so each segment's box is
+// taken from them; a point is only measured against the few segments whose
+// boxes, grown by the tolerance, hold it. Boxes are built once per
+// character, the first time it is tested, and kept until Clear.
+//
+// Paired with ParagraphLayout::GlyphAt, which finds the glyph, this picks
+// curves in laid out text without looking at any other glyph's outline.
+// ==========================================================================
+#ifndef OUTLINEBOXES_H
+#define OUTLINEBOXES_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+// A segment found under a point: which contour of the outline, which
+// segment of the contour, and how far the curve is from the point, in EM
+// units.
+
+struct SegmentHit
+{
+    unsigned int contour, segment;
+    float distance;
+};
+
+// --------------------------------------------------------------------------
+
+class OutlineBoxes
+{
+    struct SegmentBox
+    {
+        float xMin, yMin, xMax, yMax;
+        unsigned int contour, segment;
+    };
+
+    // segment boxes of each character tested so far, in the current font
+    std::unordered_map<int, std::vector<SegmentBox> > m_boxes;
+
+    const std::vector<SegmentBox> &Boxes(GlyphExtractor &extractor, int character);
+
+public:
+    // finds the segment of a character's outline nearest a point given
+    // relative to the glyph's pen position, if any is within tolerance;
+    // outlines come from the extractor's current font
+    bool SegmentAt(GlyphExtractor &extractor, int character, float x, float y,
+                   float tolerance, SegmentHit &hit);
+
+    // forgets every box, for after the font changes
+    void Clear()            { m_boxes.clear(); }
+};
+
+// --------------------------------------------------------------------------
+#endif // OUTLINEBOXES_H
@@ -0,0 +1,185 @@
+// ==========================================================================
+// Outline Decoding
+//
+// Batch conversion of outline points from font units to EM units. Points are
+// converted four at a time with SSE2 when the compiler targets it, and tags
+// are reduced to their on-curve/cubic bits in the same pass, so the decoder
+// can emit segments straight from the converted buffers.
+//
+// Also converts cubic segments to quadratic ones within a tolerance.
+// ==========================================================================
+
+#include "OutlineDecoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+#if defined(__SSE2__)
+
+// divides four interleaved (x,y,x,y) pairs by em and stores them split
+static inline void StoreEM(__m128 xy01, __m128 xy23, __m128 em, float *x, float *y)
+{
+    xy01 = _mm_div_ps(xy01, em);
+    xy23 = _mm_div_ps(xy23, em);
+    _mm_storeu_ps(x, _mm_shuffle_ps(xy01, xy23, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(y, _mm_shuffle_ps(xy01, xy23, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+#endif
+
+// --------------------------------------------------------------------------
+
+void ConvertToEM(const FT_Vector *points, const char *tags, int n,
+                 float em, EMOutlineBuffer &out)
+{
+    out.x.resize(n);
+    out.y.resize(n);
+    out.tags.resize(n);
+
+    float *x = out.x.data(), *y = out.y.data();
+    unsigned char *t = out.tags.data();
+    int p = 0;
+
+#if defined(__SSE2__)
+    // font unit coordinates always fit in 32 bits, so take the low half of
+    // each 64-bit FT_Pos; only valid where FT_Pos is 64 bits wide
+    if (sizeof(FT_Pos) == 8)
+    {
+        __m128 vem = _mm_set1_ps(em);
+        for (; p + 4 <= n; p += 4)
+        {
+            const __m128i *v = reinterpret_cast<const __m128i *>(points + p);
+            __m128i v0 = _mm_shuffle_epi32(_mm_loadu_si128(v + 0), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128i v1 = _mm_shuffle_epi32(_mm_loadu_si128(v + 1), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128i v2 = _mm_shuffle_epi32(_mm_loadu_si128(v + 2), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128i v3 = _mm_shuffle_epi32(_mm_loadu_si128(v + 3), _MM_SHUFFLE(2, 0, 2, 0));
+            StoreEM(_mm_cvtepi32_ps(_mm_unpacklo_epi64(v0, v1)),
+                    _mm_cvtepi32_ps(_mm_unpacklo_epi64(v2, v3)), vem, x + p, y + p);
+
+            // classify four tags at once
+            unsigned int word;
+            memcpy(&word, tags + p, 4);
+            word &= 0x03030303u;
+            memcpy(t + p, &word, 4);
+        }
+    }
+#endif
+
+    for (; p < n; ++p)
+    {
+        x[p] = points[p].x / em;
+        y[p] = points[p].y / em;
+        t[p] = tags[p] & 3;
+    }
+}
+
+void ConvertToEM(const short *coords, const unsigned char *packedTags, int n,
+                 float em, EMOutlineBuffer &out)
+{
+    out.x.resize(n);
+    out.y.resize(n);
+    out.tags.resize(n);
+
+    float *x = out.x.data(), *y = out.y.data();
+    unsigned char *t = out.tags.data();
+    int p = 0;
+
+#if defined(__SSE2__)
+    __m128 vem = _mm_set1_ps(em);
+    for (; p + 4 <= n; p += 4)
+    {
+        // sign-extend four (x,y) pairs of 16-bit values to 32 bits
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(coords + 2*p));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        StoreEM(_mm_cvtepi32_ps(lo), _mm_cvtepi32_ps(hi), vem, x + p, y + p);
+
+        // four points' tags share one byte
+        unsigned char packed = packedTags[p >> 2];
+        t[p+0] = packed & 3;
+        t[p+1] = (packed >> 2) & 3;
+        t[p+2] = (packed >> 4) & 3;
+        t[p+3] = (packed >> 6) & 3;
+    }
+#endif
+
+    for (; p < n; ++p)
+    {
+        x[p] = coords[2*p] / em;
+        y[p] = coords[2*p+1] / em;
+        t[p] = (packedTags[p >> 2] >> ((p & 3) * 2)) & 3;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+// most quadratics one cubic is split into, however small the tolerance
+static const int MAX_QUADRATICS = 32;
+
+void CubicToQuadratics(const MySegment &cubic, float tolerance,
+                       vector<MySegment> &quadratics)
+{
+    const float *x = cubic.x, *y = cubic.y;
+
+    // the quadratic through a cubic's ends with control point
+    // (3(p1 + p2) - p0 - p3) / 4 is within sqrt(3)/36 |p3 - 3p2 + 3p1 - p0|
+    // of it, and each of n even pieces of the cubic has a third difference
+    // n^3 times smaller
+    float dx = x[3] - 3*x[2] + 3*x[1] - x[0];
+    float dy = y[3] - 3*y[2] + 3*y[1] - y[0];
+    float bound = sqrt(3.0f) / 36.0f * sqrt(dx*dx + dy*dy);
+    int n = 1;
+    if (tolerance > 0 && bound > tolerance)
+        n = min(MAX_QUADRATICS, int(ceil(cbrt(bound / tolerance))));
+
+    // each piece runs between points on the cubic, and its inner control
+    // points lie along the cubic's tangents there, a third of the way in
+    float h = 1.0f / n;
+    float px = x[0], py = y[0];
+    float tx = 3 * (x[1] - x[0]), ty = 3 * (y[1] - y[0]);
+    for (int i = 1; i <= n; ++i)
+    {
+        float t = i * h, u = 1 - t;
+        float qx, qy, sx, sy;
+        if (i == n) {
+            // the last piece ends exactly where the cubic does
+            qx = x[3];
+            qy = y[3];
+            sx = 3 * (x[3] - x[2]);
+            sy = 3 * (y[3] - y[2]);
+        }
+        else {
+            qx = u*u*u*x[0] + 3*u*u*t*x[1] + 3*u*t*t*x[2] + t*t*t*x[3];
+            qy = u*u*u*y[0] + 3*u*u*t*y[1] + 3*u*t*t*y[2] + t*t*t*y[3];
+            sx = 3 * (u*u*(x[1] - x[0]) + 2*u*t*(x[2] - x[1]) + t*t*(x[3] - x[2]));
+            sy = 3 * (u*u*(y[1] - y[0]) + 2*u*t*(y[2] - y[1]) + t*t*(y[3] - y[2]));
+        }
+
+        float c1x = px + tx * h / 3, c1y = py + ty * h / 3;
+        float c2x = qx - sx * h / 3, c2y = qy - sy * h / 3;
+
+        MySegment quadratic(2);
+        quadratic.x[0] = px;
+        quadratic.y[0] = py;
+        quadratic.x[1] = (3 * (c1x + c2x) - px - qx) / 4;
+        quadratic.y[1] = (3 * (c1y + c2y) - py - qy) / 4;
+        quadratic.x[2] = qx;
+        quadratic.y[2] = qy;
+        quadratics.push_back(quadratic);
+
+        px = qx;
+        py = qy;
+        tx = sx;
+        ty = sy;
+    }
+}
+
+// --------------------------------------------------------------------------
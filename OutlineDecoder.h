@@ -0,0 +1,245 @@
+// ==========================================================================
+// Outline Decoding
+//
+// This internal header holds the routine that turns a TrueType/CFF style
+// point outline (points tagged on-curve, quadratic off-curve, or cubic
+// off-curve) into MySegment curves. It is shared by every place that stores
+// outlines as points rather than segments, so they all produce identical
+// segments. A Source provides ContourCount(), ContourEnd(c), At(p) returning
+// a Point with x and y members in font units, and Tag(p).
+//
+// Outlines can also be converted to EM units in one batch first (with SSE2
+// where available) and then decoded from the converted buffers, which saves
+// the per-point tag masking and division in the decoding loop.
+//
+// Any sink can be wrapped in a QuadraticSink, which replaces cubic segments
+// with quadratic ones on the way through.
+// ==========================================================================
+#ifndef OUTLINEDECODER_H
+#define OUTLINEDECODER_H
+
+#include <vector>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+// Point sources
+
+// reads points straight from a FreeType outline
+struct FTOutlineSource
+{
+    typedef FT_Vector Point;
+
+    const FT_Outline &outline;
+
+    FTOutlineSource(const FT_Outline &o) : outline(o) {}
+    int ContourCount() const            { return outline.n_contours; }
+    int ContourEnd(int c) const         { return outline.contours[c]; }
+    const Point &At(int p) const        { return outline.points[p]; }
+    int Tag(int p) const                { return outline.tags[p]; }
+};
+
+// A whole outline's points in EM units, with each tag reduced to its
+// on-curve and cubic bits.
+struct EMOutlineBuffer
+{
+    std::vector<float> x, y;
+    std::vector<unsigned char> tags;
+};
+
+// batch-convert n points in font units, and their tags, into the buffer
+void ConvertToEM(const FT_Vector *points, const char *tags, int n,
+                 float em, EMOutlineBuffer &out);
+
+// same for points stored as 16-bit pairs with tags packed 2 bits per point
+void ConvertToEM(const short *coords, const unsigned char *packedTags, int n,
+                 float em, EMOutlineBuffer &out);
+
+// reads points from a converted buffer; decode these with an em of 1
+template <class End>
+struct EMOutlineSource
+{
+    struct Point { float x, y; };
+
+    const float *x, *y;
+    const unsigned char *tags;
+    const End *ends;
+    int contours;
+
+    EMOutlineSource(const EMOutlineBuffer &b, const End *e, int c)
+        : x(b.x.data()), y(b.y.data()), tags(b.tags.data()), ends(e), contours(c)
+    {}
+    int ContourCount() const            { return contours; }
+    int ContourEnd(int c) const         { return ends[c]; }
+    Point At(int p) const
+    {
+        Point r = { x[p], y[p] };
+        return r;
+    }
+    int Tag(int p) const                { return tags[p]; }
+};
+
+template <class End>
+inline EMOutlineSource<End> MakeEMOutlineSource(const EMOutlineBuffer &buffer,
+                                                const End *ends, int contours)
+{
+    return EMOutlineSource<End>(buffer, ends, contours);
+}
+
+// --------------------------------------------------------------------------
+
+// Walks the contours of an outline in font units, converting each run of
+// on/off-curve points into line, quadratic or cubic segments in EM units.
+// The sink receives BeginContour(), AddSegment() and EndContour() calls.
+
+template <class Source, class Sink>
+inline void DecodeOutline(const Source &outline, float em, Sink &sink)
+{
+    // current point index
+    int begin = 0;
+
+    // iterate through the outline's contours
+    for (int c = 0; c < outline.ContourCount(); ++c)
+    {
+        sink.BeginContour();
+
+        // iterate through current contour's points
+        int end = outline.ContourEnd(c);
+        for (int p = begin; p <= end; ++p)
+        {
+            // index for next point, q
+            int q = p+1;
+            if (q > end) q = begin;
+
+            // retrieve position vectors
+            typename Source::Point r_p = outline.At(p);
+            typename Source::Point r_q = outline.At(q);
+
+            // create a segment to store control points
+            MySegment segment;
+
+            if (outline.Tag(p) & 1) {
+                segment.x[0] = r_p.x / em;
+                segment.y[0] = r_p.y / em;
+            }
+            else {
+                segment.x[0] = 0.5f * (r_p.x + r_q.x) / em;
+                segment.y[0] = 0.5f * (r_p.y + r_q.y) / em;
+            }
+
+            // set degree of segment based on what the next point is
+            if (outline.Tag(q) & 1)
+            {
+                // next point is on curve, so this is a line segment
+                segment.degree = 1;
+                segment.x[1] = r_q.x / em;
+                segment.y[1] = r_q.y / em;
+            }
+            else if (outline.Tag(q) & 2)
+            {
+                // next point is third degree, so this is a cubic segment
+                segment.degree = 3;
+                for (int i = 0; i < 3; ++i)
+                {
+                    segment.x[1+i] = r_q.x / em;
+                    segment.y[1+i] = r_q.y / em;
+                    if (++q > end) q = begin;
+                    r_q = outline.At(q);
+                }
+                p += 2;
+            }
+            else
+            {
+                // next point is second degree, so this is a quadratic segment
+                segment.degree = 2;
+                segment.x[1] = r_q.x / em;
+                segment.y[1] = r_q.y / em;
+
+                // advance q
+                if (++q > end) q = begin;
+                r_q = outline.At(q);
+
+                // if the next point is on curve, store and advance p
+                if (outline.Tag(q) & 1) {
+                    segment.x[2] = r_q.x / em;
+                    segment.y[2] = r_q.y / em;
+                    ++p;
+                }
+                // otherwise store the midpoint
+                else {
+                    segment.x[2] = 0.5f * (segment.x[1] + r_q.x / em);
+                    segment.y[2] = 0.5f * (segment.y[1] + r_q.y / em);
+                }
+            }
+
+            // add segment to contour
+            sink.AddSegment(segment);
+        }
+
+        // set beginning of next contour
+        begin = end + 1;
+
+        sink.EndContour();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+// --------------------------------------------------------------------------
+// Sinks
+
+// collects segments and contour spans in flat arrays
+struct FlatSink
+{
+    std::vector<MySegment> &segments;
+    std::vector<MyContourSpan> &contours;
+
+    FlatSink(std::vector<MySegment> &s, std::vector<MyContourSpan> &c)
+        : segments(s), contours(c)
+    {}
+    void BeginContour()
+    {
+        MyContourSpan span = { (unsigned int)segments.size(), 0 };
+        contours.push_back(span);
+    }
+    void AddSegment(const MySegment &s)     { segments.push_back(s); }
+    void EndContour()
+    {
+        contours.back().count = segments.size() - contours.back().begin;
+    }
+};
+
+// appends quadratic segments that follow a cubic segment to within
+// tolerance: the cubic is split evenly into as few pieces as its error
+// bound allows, and each piece is replaced by the quadratic through its
+// ends that best matches it
+void CubicToQuadratics(const MySegment &cubic, float tolerance,
+                       std::vector<MySegment> &quadratics);
+
+// passes segments on to another sink, with cubics replaced by quadratics
+template <class Sink>
+struct QuadraticSink
+{
+    Sink &sink;
+    float tolerance;
+    std::vector<MySegment> quadratics;
+
+    QuadraticSink(Sink &s, float t) : sink(s), tolerance(t)
+    {}
+    void BeginContour()                     { sink.BeginContour(); }
+    void AddSegment(const MySegment &s)
+    {
+        if (s.degree != 3) {
+            sink.AddSegment(s);
+            return;
+        }
+        quadratics.clear();
+        CubicToQuadratics(s, tolerance, quadratics);
+        for (size_t i = 0; i < quadratics.size(); ++i)
+            sink.AddSegment(quadratics[i]);
+    }
+    void EndContour()                       { sink.EndContour(); }
+};
+
+// --------------------------------------------------------------------------
+#endif // OUTLINEDECODER_H
@@ -0,0 +1,399 @@
+// ==========================================================================
+// Paragraph Layout
+//
+// Wraps text to a width, one paragraph (a run of text between newlines) at
+// a time. Each paragraph keeps its measured advances and kerning along with
+// its line breaks, and only paragraphs that were edited are measured again;
+// a width change just moves the line breaks of paragraphs that were wrapped
+// or did not fit, without asking the font for anything. An index of where
+// each paragraph's lines start maps line numbers back to paragraphs.
+//
+// The same structure answers hit tests. Lines are evenly spaced, so the
+// lines a glyph's ink could reach from a point are found arithmetically.
+// Pen positions can step back within a line, with negative kerning, so the
+// search within a line goes by cells instead: pen positions summed from
+// advances alone, no less than 0 each, which never decrease. A pen position
+// is never further from its cell than the paragraph's kerning drift, so a
+// binary search over cells finds the few glyphs whose boxes could hold a
+// point. Boxes are kept per character, and the widest reach of any of them
+// bounds both searches. Nothing extra has to be rebuilt after an edit: the
+// positions and cells are those of the paragraphs that were wrapped again.
+//
+// Lines are broken greedily after runs of spaces; a word wider than the
+// whole line is broken between characters. All positions are in EM units,
+// like TextLayout.
+// ==========================================================================
+
+#include "ParagraphLayout.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+static bool IsSpace(int character)
+{
+    return character == ' ' || character == '\t';
+}
+
+ParagraphLayout::ParagraphLayout(float width)
+    : m_width(width), m_ascent(0), m_lineHeight(0),
+      m_inkLeft(0), m_inkBottom(0), m_inkRight(0), m_inkTop(0), m_pending(0),
+      m_reindex(true), m_measured(0), m_wrapped(0)
+{}
+
+void ParagraphLayout::SetText(const string &text)
+{
+    m_paragraphs.clear();
+    m_pending = 0;
+
+    size_t begin = 0;
+    for (;;)
+    {
+        size_t end = text.find('\n', begin);
+        size_t length = (end == string::npos ? text.size() : end) - begin;
+
+        // carriage returns before a newline are dropped
+        if (length > 0 && end != string::npos && text[end - 1] == '\r')
+            --length;
+
+        m_paragraphs.push_back(Paragraph());
+        DecodeUtf8(text.data() + begin, length, m_paragraphs.back().characters);
+        ++m_pending;
+
+        if (end == string::npos) break;
+        begin = end + 1;
+    }
+    m_reindex = true;
+}
+
+void ParagraphLayout::SetParagraph(size_t paragraph, const string &text)
+{
+    Paragraph &p = m_paragraphs[paragraph];
+    DecodeUtf8(text, p.characters);
+    MarkUnwrapped(p);
+    p.measured = false;
+}
+
+void ParagraphLayout::InsertParagraph(size_t paragraph, const string &text)
+{
+    Paragraph p;
+    DecodeUtf8(text, p.characters);
+    m_paragraphs.insert(m_paragraphs.begin() + paragraph, p);
+    ++m_pending;
+    m_reindex = true;
+}
+
+void ParagraphLayout::RemoveParagraph(size_t paragraph)
+{
+    if (!m_paragraphs[paragraph].wrapped) --m_pending;
+    m_paragraphs.erase(m_paragraphs.begin() + paragraph);
+    m_reindex = true;
+}
+
+void ParagraphLayout::MarkUnwrapped(Paragraph &paragraph)
+{
+    if (paragraph.wrapped) {
+        paragraph.wrapped = false;
+        ++m_pending;
+    }
+}
+
+void ParagraphLayout::SetWidth(float width)
+{
+    if (width == m_width)
+        return;
+    m_width = width;
+
+    // a paragraph on one line that still fits keeps its single line
+    for (size_t i = 0; i < m_paragraphs.size(); ++i) {
+        Paragraph &p = m_paragraphs[i];
+        if (p.lines.size() > 1 || p.naturalWidth > width)
+            MarkUnwrapped(p);
+    }
+}
+
+void ParagraphLayout::Invalidate()
+{
+    m_boxes.clear();
+    m_inkLeft = m_inkBottom = m_inkRight = m_inkTop = 0;
+    for (size_t i = 0; i < m_paragraphs.size(); ++i) {
+        MarkUnwrapped(m_paragraphs[i]);
+        m_paragraphs[i].measured = false;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void ParagraphLayout::Measure(GlyphExtractor &extractor, Paragraph &paragraph)
+{
+    const vector<int> &characters = paragraph.characters;
+    size_t count = characters.size();
+
+    paragraph.advances.resize(count);
+    paragraph.kerning.assign(count, 0.0f);
+    if (count > 0)
+        extractor.GetAdvances(&characters[0], count, &paragraph.advances[0]);
+
+    paragraph.naturalWidth = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i + 1 < count)
+            paragraph.kerning[i] = extractor.GetKerning(characters[i], characters[i + 1]);
+        paragraph.naturalWidth += paragraph.advances[i] + paragraph.kerning[i];
+
+        // a text uses few distinct characters, so their boxes are only
+        // looked up once
+        if (m_boxes.count(characters[i]) == 0)
+        {
+            MyGlyphMetrics &box = m_boxes[characters[i]];
+            if (!extractor.GetGlyphMetrics(characters[i], box))
+                continue;
+            m_inkLeft = min(m_inkLeft, box.xMin);
+            m_inkBottom = min(m_inkBottom, box.yMin);
+            m_inkRight = max(m_inkRight, box.xMax);
+            m_inkTop = max(m_inkTop, box.yMax);
+        }
+    }
+    paragraph.measured = true;
+}
+
+void ParagraphLayout::Wrap(Paragraph &paragraph) const
+{
+    const vector<int> &characters = paragraph.characters;
+    size_t count = characters.size();
+
+    paragraph.lines.clear();
+    size_t begin = 0;
+    do {
+        // pen position, and the right edge of the last character that is
+        // not a space
+        float x = 0, width = 0;
+
+        // the last place the line can break: after a run of spaces
+        size_t breakAt = begin;
+        float breakWidth = 0;
+
+        size_t i = begin;
+        for (; i < count; ++i)
+        {
+            if (IsSpace(characters[i])) {
+                x += paragraph.advances[i] + paragraph.kerning[i];
+                if (i + 1 < count && !IsSpace(characters[i + 1])) {
+                    breakAt = i + 1;
+                    breakWidth = width;
+                }
+                continue;
+            }
+
+            float right = x + paragraph.advances[i];
+            if (right > m_width && i > begin)
+                break;
+            width = right;
+            x = right + paragraph.kerning[i];
+        }
+
+        WrappedLine line;
+        line.begin = begin;
+        if (i < count && breakAt > begin) {
+            line.end = breakAt;
+            line.width = breakWidth;
+        }
+        else {
+            line.end = i;
+            line.width = width;
+        }
+        paragraph.lines.push_back(line);
+        begin = line.end;
+    } while (begin < count);
+
+    // pen positions restart at each line, and the kerning at a break is
+    // not applied
+    paragraph.positions.resize(count);
+    paragraph.cells.resize(count);
+    paragraph.driftLow = paragraph.driftHigh = 0;
+    for (size_t l = 0; l < paragraph.lines.size(); ++l)
+    {
+        const WrappedLine &line = paragraph.lines[l];
+        float x = 0, cell = 0;
+        for (unsigned int i = line.begin; i < line.end; ++i) {
+            paragraph.positions[i] = x;
+            paragraph.cells[i] = cell;
+            paragraph.driftLow = min(paragraph.driftLow, x - cell);
+            paragraph.driftHigh = max(paragraph.driftHigh, x - cell);
+            x += paragraph.advances[i];
+            if (i + 1 < line.end) x += paragraph.kerning[i];
+            cell += max(paragraph.advances[i], 0.0f);
+        }
+    }
+
+    paragraph.wrapped = true;
+}
+
+bool ParagraphLayout::Update(GlyphExtractor &extractor)
+{
+    m_measured = m_wrapped = 0;
+
+    MyFaceMetrics metrics = extractor.GetFaceMetrics();
+    float lineHeight = metrics.ascent - metrics.descent + metrics.lineGap;
+    bool moved = lineHeight != m_lineHeight || metrics.ascent != m_ascent;
+    m_ascent = metrics.ascent;
+    m_lineHeight = lineHeight;
+
+    if (m_pending == 0 && !m_reindex)
+        return moved;
+
+    for (size_t i = 0; i < m_paragraphs.size() && m_pending > 0; ++i)
+    {
+        Paragraph &p = m_paragraphs[i];
+        if (p.wrapped) continue;
+
+        if (!p.measured) {
+            Measure(extractor, p);
+            ++m_measured;
+        }
+        Wrap(p);
+        ++m_wrapped;
+        --m_pending;
+    }
+
+    // the line index is a running count, cheap next to any measuring
+    m_firstLine.resize(m_paragraphs.size() + 1);
+    unsigned int lines = 0;
+    for (size_t i = 0; i < m_paragraphs.size(); ++i) {
+        m_firstLine[i] = lines;
+        lines += m_paragraphs[i].lines.size();
+    }
+    m_firstLine.back() = lines;
+    m_reindex = false;
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+size_t ParagraphLayout::LineParagraph(size_t line) const
+{
+    // the last paragraph starting at or before the line; empty paragraphs
+    // still have a line of their own, so no two paragraphs share a start
+    return upper_bound(m_firstLine.begin(), m_firstLine.end() - 1, line)
+           - m_firstLine.begin() - 1;
+}
+
+const WrappedLine &ParagraphLayout::Line(size_t line) const
+{
+    size_t paragraph = LineParagraph(line);
+    return m_paragraphs[paragraph].lines[line - m_firstLine[paragraph]];
+}
+
+string ParagraphLayout::LineText(size_t line) const
+{
+    const Paragraph &p = m_paragraphs[LineParagraph(line)];
+    const WrappedLine &l = Line(line);
+
+    string text;
+    for (unsigned int i = l.begin; i < l.end; ++i)
+        EncodeUtf8(p.characters[i], text);
+    return text;
+}
+
+void ParagraphLayout::LineGlyphs(size_t line, vector<PlacedGlyph> &glyphs) const
+{
+    const Paragraph &p = m_paragraphs[LineParagraph(line)];
+    const WrappedLine &l = Line(line);
+
+    glyphs.clear();
+    for (unsigned int i = l.begin; i < l.end; ++i)
+    {
+        PlacedGlyph glyph;
+        glyph.character = p.characters[i];
+        glyph.x = p.positions[i];
+        glyph.y = 0;
+        glyphs.push_back(glyph);
+    }
+}
+
+size_t ParagraphLayout::LineAt(float y) const
+{
+    size_t count = LineCount();
+    if (count == 0 || m_lineHeight <= 0 || y >= 0)
+        return 0;
+
+    size_t line = size_t(-y / m_lineHeight);
+    return min(line, count - 1);
+}
+
+// --------------------------------------------------------------------------
+
+bool ParagraphLayout::GlyphAt(float x, float y, GlyphHit &hit) const
+{
+    vector<GlyphHit> hits;
+    GlyphsIn(x, y, x, y, hits);
+    if (hits.empty())
+        return false;
+    hit = hits.back();
+    return true;
+}
+
+void ParagraphLayout::GlyphsIn(float left, float bottom, float right, float top,
+                               vector<GlyphHit> &hits) const
+{
+    size_t count = LineCount();
+    if (count == 0 || m_lineHeight <= 0)
+        return;
+
+    // a glyph on a line reaches from its baseline plus m_inkBottom up to its
+    // baseline plus m_inkTop, so only lines with baselines between these
+    // two can have one that meets the rectangle
+    float first = (-(top - m_inkBottom) - m_ascent) / m_lineHeight;
+    float last = (-(bottom - m_inkTop) - m_ascent) / m_lineHeight;
+    if (last < 0 || first > count - 1)
+        return;
+    size_t firstLine = first > 0 ? size_t(ceil(first)) : 0;
+    size_t lastLine = min(size_t(last), count - 1);
+
+    for (size_t line = firstLine; line <= lastLine; ++line)
+    {
+        size_t paragraph = LineParagraph(line);
+        const Paragraph &p = m_paragraphs[paragraph];
+        const WrappedLine &l = p.lines[line - m_firstLine[paragraph]];
+        float baseline = Baseline(line);
+
+        // likewise only glyphs with pen positions in this range can meet
+        // it, and their cells lie within the drift of it; cells are in
+        // order where pen positions need not be
+        vector<float>::const_iterator begin = p.cells.begin() + l.begin;
+        vector<float>::const_iterator end = p.cells.begin() + l.end;
+        vector<float>::const_iterator from =
+            lower_bound(begin, end, left - m_inkRight - p.driftHigh);
+        vector<float>::const_iterator to =
+            upper_bound(from, end, right - m_inkLeft - p.driftLow);
+
+        for (vector<float>::const_iterator i = from; i != to; ++i)
+        {
+            unsigned int index = i - p.cells.begin();
+            unordered_map<int, MyGlyphMetrics>::const_iterator box =
+                m_boxes.find(p.characters[index]);
+            if (box == m_boxes.end()) continue;
+
+            const MyGlyphMetrics &b = box->second;
+            float x = p.positions[index];
+            if (x + b.xMin > right || x + b.xMax < left ||
+                baseline + b.yMin > top || baseline + b.yMax < bottom)
+                continue;
+
+            GlyphHit hit;
+            hit.line = line;
+            hit.paragraph = paragraph;
+            hit.index = index;
+            hit.character = p.characters[index];
+            hit.x = x;
+            hit.y = baseline;
+            hits.push_back(hit);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
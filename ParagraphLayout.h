@@ -0,0 +1,177 @@
+// ==========================================================================
+// Paragraph Layout
+//
+// Wraps text to a width, one paragraph (a run of text between newlines) at
+// a time. Each paragraph keeps its measured advances and kerning along with
+// its line breaks, and only paragraphs that were edited are measured again;
+// a width change just moves the line breaks of paragraphs that were wrapped
+// or did not fit, without asking the font for anything. An index of where
+// each paragraph's lines start maps line numbers back to paragraphs.
+//
+// The same structure answers hit tests. Lines are evenly spaced, so the
+// lines a glyph's ink could reach from a point are found arithmetically.
+// Pen positions can step back within a line, with negative kerning, so the
+// search within a line goes by cells instead: pen positions summed from
+// advances alone, no less than 0 each, which never decrease. A pen position
+// is never further from its cell than the paragraph's kerning drift, so a
+// binary search over cells finds the few glyphs whose boxes could hold a
+// point. Boxes are kept per character, and the widest reach of any of them
+// bounds both searches. Nothing extra has to be rebuilt after an edit: the
+// positions and cells are those of the paragraphs that were wrapped again.
+//
+// Lines are broken greedily after runs of spaces; a word wider than the
+// whole line is broken between characters. All positions are in EM units,
+// like TextLayout.
+// ==========================================================================
+#ifndef PARAGRAPHLAYOUT_H
+#define PARAGRAPHLAYOUT_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GlyphExtractor.h"
+#include "TextLayout.h"
+
+// --------------------------------------------------------------------------
+// One line of a wrapped paragraph: its characters, as indices into the
+// paragraph, and its width. Spaces at a break stay at the end of the line
+// they follow, but are not counted in its width.
+
+struct WrappedLine
+{
+    unsigned int begin, end;
+    float width;
+};
+
+// --------------------------------------------------------------------------
+// A glyph found by a hit test: the line and paragraph it is on, its index
+// within the paragraph, its character, and its pen position.
+
+struct GlyphHit
+{
+    size_t line, paragraph;
+    unsigned int index;
+    int   character;
+    float x, y;
+};
+
+// --------------------------------------------------------------------------
+
+class ParagraphLayout
+{
+    struct Paragraph
+    {
+        std::vector<int> characters;
+
+        // advance of each character, and kerning between it and the next
+        std::vector<float> advances;
+        std::vector<float> kerning;
+
+        std::vector<WrappedLine> lines;
+
+        // pen position of each character from the start of its line, and
+        // its cell: the same from advances alone, each taken as no less
+        // than 0, so cells never decrease along a line
+        std::vector<float> positions;
+        std::vector<float> cells;
+
+        // least and greatest difference between a position and its cell
+        float driftLow, driftHigh;
+
+        // width of the paragraph on a single line
+        float naturalWidth;
+
+        // whether the advances, and the line breaks, are up to date
+        bool measured, wrapped;
+
+        Paragraph() : driftLow(0), driftHigh(0), naturalWidth(0), measured(false), wrapped(false)
+        {}
+    };
+
+    std::vector<Paragraph> m_paragraphs;
+
+    // first line of each paragraph, and the total line count at the end
+    std::vector<unsigned int> m_firstLine;
+
+    float m_width;
+
+    // vertical metrics of the font the text was last laid out with
+    float m_ascent, m_lineHeight;
+
+    // bounding box of each character's outline, relative to its pen
+    // position, and the box all of them fit in
+    std::unordered_map<int, MyGlyphMetrics> m_boxes;
+    float m_inkLeft, m_inkBottom, m_inkRight, m_inkTop;
+
+    // paragraphs waiting to be measured or wrapped, and whether the line
+    // index needs rebuilding even if there are none
+    unsigned int m_pending;
+    bool m_reindex;
+
+    // paragraphs measured and wrapped by the last Update
+    unsigned int m_measured, m_wrapped;
+
+    void Measure(GlyphExtractor &extractor, Paragraph &paragraph);
+    void Wrap(Paragraph &paragraph) const;
+    void MarkUnwrapped(Paragraph &paragraph);
+
+public:
+    ParagraphLayout(float width = 1.0f);
+
+    // replaces the whole text; paragraphs are separated by newlines
+    void SetText(const std::string &text);
+
+    // edits a single paragraph, given as UTF-8 text without newlines; only
+    // that paragraph is laid out again by the next Update
+    void SetParagraph(size_t paragraph, const std::string &text);
+    void InsertParagraph(size_t paragraph, const std::string &text);
+    void RemoveParagraph(size_t paragraph);
+
+    // sets the width lines are wrapped to, in EM units
+    void SetWidth(float width);
+    float Width() const                 { return m_width; }
+
+    // marks every paragraph to be measured again, for after the font changes
+    void Invalidate();
+
+    // measures and wraps whatever changed since the last call, using the
+    // extractor's current font; returns true if any line moved
+    bool Update(GlyphExtractor &extractor);
+
+    size_t ParagraphCount() const       { return m_paragraphs.size(); }
+    size_t LineCount() const            { return m_firstLine.empty() ? 0 : m_firstLine.back(); }
+
+    // first line of a paragraph, and the paragraph a line belongs to
+    size_t FirstLine(size_t paragraph) const    { return m_firstLine[paragraph]; }
+    size_t LineParagraph(size_t line) const;
+
+    const WrappedLine &Line(size_t line) const;
+
+    // text of a line, as UTF-8, including any spaces it ends with
+    std::string LineText(size_t line) const;
+
+    // the glyphs of a line placed from its start on the baseline
+    void LineGlyphs(size_t line, std::vector<PlacedGlyph> &glyphs) const;
+
+    // y of a line's baseline, with the top of the first line at 0 and lines
+    // going down, and the line at a given y (clamped to the text)
+    float Baseline(size_t line) const   { return -(m_ascent + line * m_lineHeight); }
+    float LineHeight() const            { return m_lineHeight; }
+    size_t LineAt(float y) const;
+
+    // the glyph whose outline's bounding box holds a point, the last one
+    // laid out if several overlap; returns false if there is none
+    bool GlyphAt(float x, float y, GlyphHit &hit) const;
+
+    // appends the glyphs whose bounding boxes meet a rectangle, in order
+    void GlyphsIn(float left, float bottom, float right, float top,
+                  std::vector<GlyphHit> &hits) const;
+
+    // how much work the last Update did
+    unsigned int ParagraphsMeasured() const     { return m_measured; }
+    unsigned int ParagraphsWrapped() const      { return m_wrapped; }
+};
+
+// --------------------------------------------------------------------------
+#endif // PARAGRAPHLAYOUT_H
@@ -0,0 +1,246 @@
+// ==========================================================================
+// Pooling Memory Allocator for FreeType
+//
+// This module provides an FT_Memory whose small allocations come from pools
+// of fixed-size blocks, one pool per size class, instead of going to malloc
+// every time. FreeType allocates and frees many small objects while loading
+// glyphs; with the pools those become free-list pushes and pops. Requests
+// larger than the biggest size class go to malloc directly.
+//
+// Every allocation is tagged with an owner, normally the id of the face it
+// was made for, so live bytes, peak bytes and allocation counts can be read
+// back per font. The allocator is not thread safe: it should serve a single
+// FT_Library that is used from one thread at a time.
+// ==========================================================================
+
+#include "PoolAllocator.h"
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+// block sizes served from pools; anything bigger goes to malloc
+static const size_t SIZE_CLASSES[] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048
+};
+static const int CLASS_COUNT = sizeof(SIZE_CLASSES) / sizeof(SIZE_CLASSES[0]);
+static const int LARGE_BLOCK = -1;
+
+// pools grow by chunks of this many bytes
+static const size_t CHUNK_SIZE = 64 * 1024;
+
+// Every block starts with a header recording what it was allocated as; the
+// header is padded so the memory handed to FreeType stays 16-byte aligned.
+struct BlockHeader
+{
+    size_t size;
+    int    owner;
+    int    sizeClass;
+};
+
+static const size_t HEADER_SIZE = 16;
+
+static BlockHeader *HeaderOf(void *block)
+{
+    return reinterpret_cast<BlockHeader *>(static_cast<char *>(block) - HEADER_SIZE);
+}
+
+// size class for each multiple of 16 bytes up to the largest class, so
+// finding the class is one table lookup
+struct SizeClassTable
+{
+    signed char classes[2048 / 16 + 1];
+
+    SizeClassTable()
+    {
+        int c = 0;
+        for (size_t i = 0; i < sizeof(classes); ++i) {
+            while (i * 16 > SIZE_CLASSES[c]) ++c;
+            classes[i] = (signed char)c;
+        }
+    }
+};
+
+static const SizeClassTable s_sizeClasses;
+
+static int SizeClass(size_t size)
+{
+    if (size > SIZE_CLASSES[CLASS_COUNT - 1]) return LARGE_BLOCK;
+    return s_sizeClasses.classes[(size + 15) / 16];
+}
+
+// --------------------------------------------------------------------------
+
+PoolAllocator::PoolAllocator()
+    : m_freeLists(CLASS_COUNT, static_cast<void *>(0)), m_reserved(0),
+      m_heapAllocations(0), m_owner(-1)
+{
+    m_memory.user = this;
+    m_memory.alloc = AllocCallback;
+    m_memory.free = FreeCallback;
+    m_memory.realloc = ReallocCallback;
+}
+
+PoolAllocator::~PoolAllocator()
+{
+    // large blocks still alive belong to a library that was not released,
+    // and are left alone; pooled blocks go with their chunks
+    for (size_t i = 0; i < m_chunks.size(); ++i)
+        free(m_chunks[i]);
+}
+
+// --------------------------------------------------------------------------
+
+void *PoolAllocator::Allocate(size_t size, int owner)
+{
+    int sizeClass = SizeClass(size);
+    char *p;
+
+    if (sizeClass == LARGE_BLOCK)
+    {
+        p = static_cast<char *>(malloc(HEADER_SIZE + size));
+        if (!p) return 0;
+        m_reserved += HEADER_SIZE + size;
+        ++m_heapAllocations;
+    }
+    else
+    {
+        // refill an empty pool by carving a new chunk into blocks
+        void *&head = m_freeLists[sizeClass];
+        if (!head)
+        {
+            size_t stride = HEADER_SIZE + SIZE_CLASSES[sizeClass];
+            char *chunk = static_cast<char *>(malloc(CHUNK_SIZE));
+            if (!chunk) return 0;
+            m_chunks.push_back(chunk);
+            m_reserved += CHUNK_SIZE;
+            ++m_heapAllocations;
+
+            for (size_t offset = 0; offset + stride <= CHUNK_SIZE; offset += stride)
+            {
+                void **link = reinterpret_cast<void **>(chunk + offset);
+                *link = head;
+                head = link;
+            }
+        }
+        p = static_cast<char *>(head);
+        head = *static_cast<void **>(head);
+    }
+
+    BlockHeader *header = reinterpret_cast<BlockHeader *>(p);
+    header->size = size;
+    header->owner = owner;
+    header->sizeClass = sizeClass;
+
+    OwnerStats(owner).allocations++;
+    m_total.allocations++;
+    Record(owner, long(size));
+
+    // FreeType clears memory itself where it needs to, like malloc
+    return p + HEADER_SIZE;
+}
+
+void PoolAllocator::Free(void *block)
+{
+    if (!block) return;
+    BlockHeader *header = HeaderOf(block);
+
+    OwnerStats(header->owner).frees++;
+    m_total.frees++;
+    Record(header->owner, -long(header->size));
+
+    if (header->sizeClass == LARGE_BLOCK)
+    {
+        m_reserved -= HEADER_SIZE + header->size;
+        free(header);
+    }
+    else
+    {
+        void **link = reinterpret_cast<void **>(header);
+        *link = m_freeLists[header->sizeClass];
+        m_freeLists[header->sizeClass] = link;
+    }
+}
+
+void *PoolAllocator::Reallocate(void *block, size_t size)
+{
+    if (!block) return Allocate(size, m_owner);
+    BlockHeader *header = HeaderOf(block);
+
+    OwnerStats(header->owner).reallocations++;
+    m_total.reallocations++;
+
+    // grow or shrink in place while the new size fits the same block
+    if (header->sizeClass != LARGE_BLOCK && size <= SIZE_CLASSES[header->sizeClass])
+    {
+        Record(header->owner, long(size) - long(header->size));
+        header->size = size;
+        return block;
+    }
+
+    // otherwise move it, keeping the block's owner; the move is counted as
+    // a reallocation only, not as an allocation and a free
+    int owner = header->owner;
+    size_t oldSize = header->size;
+    void *moved = Allocate(size, owner);
+    if (!moved) return 0;
+    memcpy(moved, block, oldSize < size ? oldSize : size);
+    Free(block);
+
+    MemoryStats &stats = OwnerStats(owner);
+    stats.allocations--;
+    stats.frees--;
+    m_total.allocations--;
+    m_total.frees--;
+    return moved;
+}
+
+// --------------------------------------------------------------------------
+
+MemoryStats &PoolAllocator::OwnerStats(int owner)
+{
+    size_t index = size_t(owner + 1);
+    if (index >= m_owners.size())
+        m_owners.resize(index + 1);
+    return m_owners[index];
+}
+
+void PoolAllocator::Record(int owner, long bytes)
+{
+    MemoryStats &stats = OwnerStats(owner);
+    stats.liveBytes += bytes;
+    if (stats.liveBytes > stats.peakBytes) stats.peakBytes = stats.liveBytes;
+
+    m_total.liveBytes += bytes;
+    if (m_total.liveBytes > m_total.peakBytes) m_total.peakBytes = m_total.liveBytes;
+}
+
+MemoryStats PoolAllocator::Stats(int owner) const
+{
+    size_t index = size_t(owner + 1);
+    return index < m_owners.size() ? m_owners[index] : MemoryStats();
+}
+
+// --------------------------------------------------------------------------
+
+void *PoolAllocator::AllocCallback(FT_Memory memory, long size)
+{
+    PoolAllocator *self = static_cast<PoolAllocator *>(memory->user);
+    return self->Allocate(size_t(size), self->m_owner);
+}
+
+void PoolAllocator::FreeCallback(FT_Memory memory, void *block)
+{
+    static_cast<PoolAllocator *>(memory->user)->Free(block);
+}
+
+void *PoolAllocator::ReallocCallback(FT_Memory memory, long curSize, long newSize,
+                                     void *block)
+{
+    (void)curSize;
+    return static_cast<PoolAllocator *>(memory->user)->Reallocate(block, size_t(newSize));
+}
+
+// --------------------------------------------------------------------------
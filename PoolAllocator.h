@@ -0,0 +1,98 @@
+// ==========================================================================
+// Pooling Memory Allocator for FreeType
+//
+// This module provides an FT_Memory whose small allocations come from pools
+// of fixed-size blocks, one pool per size class, instead of going to malloc
+// every time. FreeType allocates and frees many small objects while loading
+// glyphs; with the pools those become free-list pushes and pops. Requests
+// larger than the biggest size class go to malloc directly.
+//
+// Every allocation is tagged with an owner, normally the id of the face it
+// was made for, so live bytes, peak bytes and allocation counts can be read
+// back per font. The allocator is not thread safe: it should serve a single
+// FT_Library that is used from one thread at a time.
+// ==========================================================================
+#ifndef POOLALLOCATOR_H
+#define POOLALLOCATOR_H
+
+#include <cstddef>
+#include <vector>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_SYSTEM_H
+
+// --------------------------------------------------------------------------
+// Memory use of one owner, or of the whole allocator. Byte counts are the
+// sizes FreeType asked for, not including pool rounding.
+
+struct MemoryStats
+{
+    size_t liveBytes, peakBytes;
+    unsigned long allocations, frees, reallocations;
+
+    MemoryStats() : liveBytes(0), peakBytes(0), allocations(0), frees(0),
+                    reallocations(0)
+    {}
+};
+
+// --------------------------------------------------------------------------
+
+class PoolAllocator
+{
+    FT_MemoryRec_ m_memory;
+
+    // free lists of released blocks, one per size class, and the chunks the
+    // blocks were carved from
+    std::vector<void *> m_freeLists;
+    std::vector<char *> m_chunks;
+    size_t m_reserved;
+    unsigned long m_heapAllocations;
+
+    // statistics by owner + 1 (entry 0 is for allocations with no owner),
+    // and over all owners
+    std::vector<MemoryStats> m_owners;
+    MemoryStats m_total;
+    int m_owner;
+
+    void *Allocate(size_t size, int owner);
+    void Free(void *block);
+    void *Reallocate(void *block, size_t size);
+
+    MemoryStats &OwnerStats(int owner);
+    void Record(int owner, long bytes);
+
+    // callbacks installed in m_memory
+    static void *AllocCallback(FT_Memory memory, long size);
+    static void FreeCallback(FT_Memory memory, void *block);
+    static void *ReallocCallback(FT_Memory memory, long curSize, long newSize,
+                                 void *block);
+
+    PoolAllocator(const PoolAllocator &);
+    PoolAllocator &operator=(const PoolAllocator &);
+
+public:
+    PoolAllocator();
+    ~PoolAllocator();
+
+    // memory object to pass to FT_New_Library; it must not outlive this
+    // allocator, so the library has to be released with FT_Done_Library
+    FT_Memory Memory()  { return &m_memory; }
+
+    // allocations made from now on are charged to the given owner; use -1
+    // for memory that belongs to no face in particular
+    void SetOwner(int owner)    { m_owner = owner; }
+    int Owner() const           { return m_owner; }
+
+    // statistics for one owner, and for all of them together
+    MemoryStats Stats(int owner) const;
+    const MemoryStats &TotalStats() const   { return m_total; }
+
+    // bytes taken from the heap for pools and large blocks, and how many
+    // times the heap was called to get them
+    size_t BytesReserved() const                { return m_reserved; }
+    unsigned long HeapAllocations() const       { return m_heapAllocations; }
+};
+
+// --------------------------------------------------------------------------
+#endif // POOLALLOCATOR_H
@@ -0,0 +1,105 @@
+// ==========================================================================
+// Text Document
+//
+// A read-only view of a text file of any size. The file is memory-mapped
+// (see MappedFile.h), so only the pages that are actually read take up
+// memory, and a sparse line index records where every INDEX_STRIDE-th line
+// starts. Finding a line is a jump to the nearest indexed line and a scan
+// over at most INDEX_STRIDE - 1 newlines, so a view can fetch just the
+// lines it shows without the document ever being read as a whole.
+// ==========================================================================
+
+#include "TextDocument.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+TextDocument::TextDocument()
+    : m_lineCount(0)
+{}
+
+bool TextDocument::Open(const string &filename)
+{
+    Close();
+
+    m_file = MappedFile::Open(filename);
+    if (!m_file) {
+        cout << "TextDocument ERROR: Could not open " << filename << endl;
+        return false;
+    }
+
+    // memchr finds newlines far faster than a loop over the bytes would
+    const char *data = reinterpret_cast<const char *>(m_file->Data());
+    const char *end = data + m_file->Size();
+    const char *p = data;
+
+    m_index.push_back(0);
+    m_lineCount = 1;
+    while (p < end)
+    {
+        const char *newline = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (!newline) break;
+        p = newline + 1;
+
+        // a newline at the very end does not start another line
+        if (p == end) break;
+        if (m_lineCount % INDEX_STRIDE == 0)
+            m_index.push_back(p - data);
+        ++m_lineCount;
+    }
+    return true;
+}
+
+void TextDocument::Close()
+{
+    m_file.reset();
+    m_index.clear();
+    m_lineCount = 0;
+}
+
+// --------------------------------------------------------------------------
+
+string TextDocument::Line(size_t line, size_t maxBytes) const
+{
+    if (line >= m_lineCount)
+        return string();
+
+    const char *data = reinterpret_cast<const char *>(m_file->Data());
+    const char *end = data + m_file->Size();
+
+    // start from the nearest indexed line at or before this one
+    const char *p = data + m_index[line / INDEX_STRIDE];
+    for (size_t skip = line % INDEX_STRIDE; skip > 0; --skip)
+        p = static_cast<const char *>(memchr(p, '\n', end - p)) + 1;
+
+    const char *newline = static_cast<const char *>(memchr(p, '\n', end - p));
+    size_t length = (newline ? newline : end) - p;
+    if (length > 0 && p[length - 1] == '\r')
+        --length;
+
+    // cut long lines between characters, never inside one
+    if (length > maxBytes) {
+        length = maxBytes;
+        while (length > 0 && (p[length] & 0xC0) == 0x80)
+            --length;
+    }
+    return string(p, length);
+}
+
+void TextDocument::VisibleLines(float scroll, float viewLines, size_t margin,
+                                size_t &first, size_t &end) const
+{
+    float top = max(floor(scroll), 0.0f);
+    float bottom = max(ceil(scroll + viewLines), 0.0f);
+
+    first = min(size_t(top), m_lineCount);
+    end = min(size_t(bottom) + margin, m_lineCount);
+    first = first > margin ? first - margin : 0;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,60 @@
+// ==========================================================================
+// Text Document
+//
+// A read-only view of a text file of any size. The file is memory-mapped
+// (see MappedFile.h), so only the pages that are actually read take up
+// memory, and a sparse line index records where every INDEX_STRIDE-th line
+// starts. Finding a line is a jump to the nearest indexed line and a scan
+// over at most INDEX_STRIDE - 1 newlines, so a view can fetch just the
+// lines it shows without the document ever being read as a whole.
+// ==========================================================================
+#ifndef TEXTDOCUMENT_H
+#define TEXTDOCUMENT_H
+
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// --------------------------------------------------------------------------
+
+class TextDocument
+{
+public:
+    static const size_t INDEX_STRIDE = 64;
+
+private:
+    MappedFileHandle m_file;
+
+    // byte offset of lines 0, INDEX_STRIDE, 2 * INDEX_STRIDE, ...
+    std::vector<size_t> m_index;
+    size_t m_lineCount;
+
+    TextDocument(const TextDocument &);
+    TextDocument &operator=(const TextDocument &);
+
+public:
+    TextDocument();
+
+    // maps the file and builds its line index; returns false if the file
+    // cannot be mapped, which includes empty files
+    bool Open(const std::string &filename);
+    void Close();
+
+    size_t LineCount() const        { return m_lineCount; }
+    size_t Bytes() const            { return m_file ? m_file->Size() : 0; }
+    size_t IndexBytes() const       { return m_index.capacity() * sizeof(size_t); }
+
+    // the text of a line without its line ending; lines longer than
+    // maxBytes are cut off at the last whole UTF-8 character that fits
+    std::string Line(size_t line, size_t maxBytes = std::string::npos) const;
+
+    // the range of lines [first, end) that a view of viewLines lines
+    // scrolled down by scroll lines shows, widened by margin lines on each
+    // side and clamped to the document
+    void VisibleLines(float scroll, float viewLines, size_t margin,
+                      size_t &first, size_t &end) const;
+};
+
+// --------------------------------------------------------------------------
+#endif // TEXTDOCUMENT_H
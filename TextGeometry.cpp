@@ -0,0 +1,101 @@
+// ==========================================================================
+// Text Patch Geometry
+//
+// Turns glyph outlines into the control points the tessellation shaders
+// draw. Every segment becomes a patch of patchSize points: 3 when curves
+// are drawn as quadratic Beziers, 4 for cubics. Curves of the other degree,
+// from a fallback font, are converted: quadratics are raised to cubics
+// exactly, and cubics split into quadratics. Straight lines are padded
+// to the patch size by repeating their endpoints, which the curve
+// evaluation turns back into a straight line; the tessellation control
+// shader sees that such a patch is straight and draws it as one line
+// rather than subdividing it like a curve.
+// ==========================================================================
+
+#include "TextGeometry.h"
+#include "OutlineDecoder.h"
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+
+// how far, in EM units, the quadratics standing in for a cubic may stray
+// from it when a cubic has to go into a 3-point patch
+static const float CUBIC_TOLERANCE = 0.001f;
+
+// appends one patch through the given control points
+static void AppendPatch(const vec2 *points, int count, float x, float y, float scale,
+                        const vec3 &colour, vector<vec2> &vertices, vector<vec3> &colours)
+{
+    for (int i = 0; i < count; ++i) {
+        vertices.push_back((points[i] + vec2(x, y)) * scale);
+        colours.push_back(colour);
+    }
+}
+
+void AppendGlyphPatches(const MyOutline &glyph, float x, float y, float scale,
+                        int patchSize, const vec3 &colour,
+                        vector<vec2> &vertices, vector<vec3> &colours)
+{
+    // with fallback fonts a glyph's curves need not have the degree its
+    // patches are drawn with, so every segment is brought to the patch size
+    vector<MySegment> quadratics;
+    for (unsigned int c = 0; c < glyph.contourCount; ++c)
+    {
+        for (const MySegment *s = glyph.ContourBegin(c); s != glyph.ContourEnd(c); ++s)
+        {
+            const MySegment &segment = *s;
+            vec2 p[4];
+            for (unsigned int i = 0; i <= segment.degree; ++i)
+                p[i] = vec2(segment.x[i], segment.y[i]);
+
+            if (segment.degree == 3 && patchSize == 3)
+            {
+                // a cubic is split into quadratics close enough to it
+                quadratics.clear();
+                CubicToQuadratics(segment, CUBIC_TOLERANCE, quadratics);
+                for (size_t q = 0; q < quadratics.size(); ++q) {
+                    vec2 points[3];
+                    for (int i = 0; i < 3; ++i)
+                        points[i] = vec2(quadratics[q].x[i], quadratics[q].y[i]);
+                    AppendPatch(points, 3, x, y, scale, colour, vertices, colours);
+                }
+            }
+            else if (segment.degree == 2 && patchSize == 4)
+            {
+                // a quadratic is exactly the cubic with its control point
+                // two thirds of the way from each end
+                vec2 points[4] = { p[0], p[0] + 2.0f / 3.0f * (p[1] - p[0]),
+                                   p[2] + 2.0f / 3.0f * (p[1] - p[2]), p[2] };
+                AppendPatch(points, 4, x, y, scale, colour, vertices, colours);
+            }
+            else if (segment.degree == 1)
+            {
+                // a line is drawn as p0 p0 p1 p1 in a cubic patch, and as
+                // p0 p0 p1 in a quadratic one
+                vec2 points[4] = { p[0], p[0], p[1], p[1] };
+                AppendPatch(points, patchSize, x, y, scale,
+                            colour, vertices, colours);
+            }
+            else
+                AppendPatch(p, segment.degree + 1, x, y, scale, colour, vertices, colours);
+        }
+    }
+}
+
+void AppendTextPatches(GlyphExtractor &extractor, const TextLayout &layout,
+                       float x, float y, float scale, int patchSize,
+                       const vec3 &colour,
+                       vector<vec2> &vertices, vector<vec3> &colours)
+{
+    const vector<PlacedGlyph> &glyphs = layout.Glyphs();
+    for (size_t i = 0; i < glyphs.size(); ++i)
+    {
+        const MyOutline &glyph = extractor.CachedOutline(glyphs[i].character);
+        AppendGlyphPatches(glyph, x + glyphs[i].x, y + glyphs[i].y, scale,
+                           patchSize, colour, vertices, colours);
+    }
+}
+
+// --------------------------------------------------------------------------
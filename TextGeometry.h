@@ -0,0 +1,40 @@
+// ==========================================================================
+// Text Patch Geometry
+//
+// Turns glyph outlines into the control points the tessellation shaders
+// draw. Every segment becomes a patch of patchSize points: 3 when curves
+// are drawn as quadratic Beziers, 4 for cubics. Curves of the other degree,
+// from a fallback font, are converted: quadratics are raised to cubics
+// exactly, and cubics split into quadratics. Straight lines are padded
+// to the patch size by repeating their endpoints, which the curve
+// evaluation turns back into a straight line; the tessellation control
+// shader sees that such a patch is straight and draws it as one line
+// rather than subdividing it like a curve.
+// ==========================================================================
+#ifndef TEXTGEOMETRY_H
+#define TEXTGEOMETRY_H
+
+#include <vector>
+#include <glm-0.9.8.2/glm/glm.hpp>
+
+#include "GlyphExtractor.h"
+#include "TextLayout.h"
+
+// --------------------------------------------------------------------------
+
+// appends the patches for one glyph outline with its pen position at (x,y),
+// all in EM units, then scaled by scale
+void AppendGlyphPatches(const MyOutline &glyph, float x, float y, float scale,
+                        int patchSize, const glm::vec3 &colour,
+                        std::vector<glm::vec2> &vertices,
+                        std::vector<glm::vec3> &colours);
+
+// appends the patches for every glyph of a laid out line, starting at (x,y)
+void AppendTextPatches(GlyphExtractor &extractor, const TextLayout &layout,
+                       float x, float y, float scale, int patchSize,
+                       const glm::vec3 &colour,
+                       std::vector<glm::vec2> &vertices,
+                       std::vector<glm::vec3> &colours);
+
+// --------------------------------------------------------------------------
+#endif // TEXTGEOMETRY_H
@@ -0,0 +1,152 @@
+// ==========================================================================
+// Text Geometry Cache
+//
+// Keeps the patch geometry of laid out strings in GPU buffers, so a string
+// that is drawn frame after frame is laid out, tessellated into patches and
+// uploaded only once. Entries are keyed by the text, the font, the scale and
+// the patch size (curve degree mode) it was built for. Geometry is built at
+// the origin; movement such as scrolling is applied when drawing, so it
+// does not invalidate anything. When the buffers of all entries exceed the
+// memory budget, the least recently used entries are deleted.
+// ==========================================================================
+
+#include "TextGeometryCache.h"
+#include "TextGeometry.h"
+#include <cstring>
+#include <vector>
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+
+TextGeometryCache::TextGeometryCache(size_t budgetBytes)
+    : m_budget(budgetBytes), m_bytes(0), m_hits(0), m_misses(0)
+{}
+
+TextGeometryCache::~TextGeometryCache()
+{
+    Clear();
+}
+
+// --------------------------------------------------------------------------
+
+string TextGeometryCache::MakeKey(const string &text, const string &font,
+                                  float scale, int patchSize)
+{
+    // scale and patch size first, then the font name, ended by a zero byte
+    // that no file name contains, then the text
+    char numbers[sizeof(float) + sizeof(int)];
+    memcpy(numbers, &scale, sizeof(float));
+    memcpy(numbers + sizeof(float), &patchSize, sizeof(int));
+
+    string key;
+    key.reserve(font.size() + text.size() + 1 + sizeof(numbers));
+    key.append(numbers, sizeof(numbers));
+    key.append(font);
+    key += '\0';
+    key.append(text);
+    return key;
+}
+
+const CachedText &TextGeometryCache::Get(GlyphExtractor &extractor, const string &font,
+                                         const string &text, float scale, int patchSize)
+{
+    extractor.LoadFontFile(font);
+
+    string key = MakeKey(text, font, scale, patchSize);
+    unordered_map<string, Entry>::iterator it = m_entries.find(key);
+    if (it != m_entries.end())
+    {
+        ++m_hits;
+        m_recent.splice(m_recent.begin(), m_recent, it->second.recent);
+        return it->second.text;
+    }
+
+    ++m_misses;
+    Entry &entry = m_entries[key];
+    Build(extractor, text, scale, patchSize, entry.text);
+    m_recent.push_front(key);
+    entry.recent = m_recent.begin();
+    m_bytes += entry.text.bytes;
+
+    Evict();
+    return entry.text;
+}
+
+void TextGeometryCache::SetBudget(size_t budgetBytes)
+{
+    m_budget = budgetBytes;
+    Evict();
+}
+
+void TextGeometryCache::Evict()
+{
+    while (m_bytes > m_budget && m_recent.size() > 1)
+    {
+        unordered_map<string, Entry>::iterator it = m_entries.find(m_recent.back());
+        m_bytes -= it->second.text.bytes;
+        Destroy(it->second.text);
+        m_entries.erase(it);
+        m_recent.pop_back();
+    }
+}
+
+void TextGeometryCache::Clear()
+{
+    for (unordered_map<string, Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+        Destroy(it->second.text);
+    m_entries.clear();
+    m_recent.clear();
+    m_bytes = 0;
+}
+
+// --------------------------------------------------------------------------
+
+bool TextGeometryCache::Build(GlyphExtractor &extractor, const string &text,
+                              float scale, int patchSize, CachedText &geometry)
+{
+    const GLuint VERTEX_INDEX = 0;
+    const GLuint COLOUR_INDEX = 1;
+
+    m_layout.LayoutLine(extractor, text);
+
+    vector<vec2> vertices;
+    vector<vec3> colours;
+    AppendTextPatches(extractor, m_layout, 0.0f, 0.0f, scale, patchSize,
+                      vec3(1.0f, 1.0f, 1.0f), vertices, colours);
+
+    geometry.elementCount = vertices.size();
+    geometry.width = m_layout.Width();
+    geometry.bytes = vertices.size() * sizeof(vec2) + colours.size() * sizeof(vec3);
+
+    glGenBuffers(1, &geometry.vertexBuffer);
+    glGenBuffers(1, &geometry.colourBuffer);
+    glGenVertexArrays(1, &geometry.vertexArray);
+    glBindVertexArray(geometry.vertexArray);
+
+    glBindBuffer(GL_ARRAY_BUFFER, geometry.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(VERTEX_INDEX, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+    glEnableVertexAttribArray(VERTEX_INDEX);
+
+    glBindBuffer(GL_ARRAY_BUFFER, geometry.colourBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * colours.size(), colours.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(COLOUR_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), 0);
+    glEnableVertexAttribArray(COLOUR_INDEX);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+void TextGeometryCache::Destroy(CachedText &geometry)
+{
+    glDeleteVertexArrays(1, &geometry.vertexArray);
+    glDeleteBuffers(1, &geometry.vertexBuffer);
+    glDeleteBuffers(1, &geometry.colourBuffer);
+    geometry = CachedText();
+}
+
+// --------------------------------------------------------------------------
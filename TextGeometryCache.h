@@ -0,0 +1,105 @@
+// ==========================================================================
+// Text Geometry Cache
+//
+// Keeps the patch geometry of laid out strings in GPU buffers, so a string
+// that is drawn frame after frame is laid out, tessellated into patches and
+// uploaded only once. Entries are keyed by the text, the font, the scale and
+// the patch size (curve degree mode) it was built for. Geometry is built at
+// the origin; movement such as scrolling is applied when drawing, so it
+// does not invalidate anything. When the buffers of all entries exceed the
+// memory budget, the least recently used entries are deleted.
+//
+// An OpenGL context must be current whenever the cache is used or destroyed.
+// ==========================================================================
+#ifndef TEXTGEOMETRYCACHE_H
+#define TEXTGEOMETRYCACHE_H
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include <glad/include/glad/glad.h>
+
+#include "GlyphExtractor.h"
+#include "TextLayout.h"
+
+// --------------------------------------------------------------------------
+// GPU geometry for one string: a vertex array with positions at attribute 0
+// and colours at attribute 1, ready to draw as patches.
+
+struct CachedText
+{
+    GLuint  vertexBuffer;
+    GLuint  colourBuffer;
+    GLuint  vertexArray;
+    GLsizei elementCount;
+
+    // width of the laid out line, in EM units
+    float   width;
+
+    // bytes of buffer memory used
+    size_t  bytes;
+
+    CachedText() : vertexBuffer(0), colourBuffer(0), vertexArray(0),
+                   elementCount(0), width(0), bytes(0)
+    {}
+};
+
+// --------------------------------------------------------------------------
+
+class TextGeometryCache
+{
+    struct Entry
+    {
+        CachedText text;
+        std::list<std::string>::iterator recent;
+    };
+
+    // entries by key, and keys from most to least recently used
+    std::unordered_map<std::string, Entry> m_entries;
+    std::list<std::string> m_recent;
+
+    size_t m_budget, m_bytes;
+    unsigned long m_hits, m_misses;
+
+    // layout and patch data for the entry being built
+    TextLayout m_layout;
+
+    static std::string MakeKey(const std::string &text, const std::string &font,
+                               float scale, int patchSize);
+
+    bool Build(GlyphExtractor &extractor, const std::string &text,
+               float scale, int patchSize, CachedText &geometry);
+    static void Destroy(CachedText &geometry);
+
+    // deletes least recently used entries until the budget is met, keeping
+    // at least the most recent one
+    void Evict();
+
+    TextGeometryCache(const TextGeometryCache &);
+    TextGeometryCache &operator=(const TextGeometryCache &);
+
+public:
+    TextGeometryCache(size_t budgetBytes = 4 * 1024 * 1024);
+    ~TextGeometryCache();
+
+    // returns the geometry for a string drawn in the given font, at the
+    // given scale, as patches of patchSize points; the font is made the
+    // extractor's current one. The reference stays valid until the next
+    // call or until the entry is evicted.
+    const CachedText &Get(GlyphExtractor &extractor, const std::string &font,
+                          const std::string &text, float scale, int patchSize);
+
+    void SetBudget(size_t budgetBytes);
+
+    // deletes every entry
+    void Clear();
+
+    size_t BytesUsed() const            { return m_bytes; }
+    size_t EntryCount() const           { return m_entries.size(); }
+    unsigned long Hits() const          { return m_hits; }
+    unsigned long Misses() const        { return m_misses; }
+};
+
+// --------------------------------------------------------------------------
+#endif // TEXTGEOMETRYCACHE_H
@@ -0,0 +1,49 @@
+// ==========================================================================
+// Text Layout
+//
+// Places the glyphs of a line of text using the font's own metrics: each
+// glyph's pen position is the previous one's plus its advance width and
+// the kerning between the two characters. Advances and kerning come from
+// the GlyphExtractor's current font, so the layout is in EM units and can
+// be scaled to any size when the glyphs are drawn.
+// ==========================================================================
+
+#include "TextLayout.h"
+#include "Utf8.h"
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+TextLayout::TextLayout()
+    : m_width(0), m_tracking(0)
+{}
+
+void TextLayout::LayoutLine(GlyphExtractor &extractor, const string &text)
+{
+    m_glyphs.clear();
+    m_width = 0;
+    if (text.empty())
+        return;
+
+    DecodeUtf8(text, m_characters);
+    m_advances.resize(m_characters.size());
+    extractor.GetAdvances(&m_characters[0], m_characters.size(), &m_advances[0]);
+
+    float x = 0;
+    m_glyphs.resize(m_characters.size());
+    for (size_t i = 0; i < m_characters.size(); ++i)
+    {
+        PlacedGlyph &glyph = m_glyphs[i];
+        glyph.character = m_characters[i];
+        glyph.x = x;
+        glyph.y = 0;
+
+        x += m_advances[i] + m_tracking;
+        if (i + 1 < m_characters.size())
+            x += extractor.GetKerning(m_characters[i], m_characters[i + 1]);
+    }
+    m_width = x;
+}
+
+// --------------------------------------------------------------------------
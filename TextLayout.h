@@ -0,0 +1,58 @@
+// ==========================================================================
+// Text Layout
+//
+// Places the glyphs of a line of text using the font's own metrics: each
+// glyph's pen position is the previous one's plus its advance width and
+// the kerning between the two characters. Advances and kerning come from
+// the GlyphExtractor's current font, so the layout is in EM units and can
+// be scaled to any size when the glyphs are drawn.
+// ==========================================================================
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+#include <string>
+#include <vector>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+// A glyph placed on a line: its character and the pen position its outline
+// is drawn from, in EM units relative to the start of the line.
+
+struct PlacedGlyph
+{
+    int   character;
+    float x, y;
+};
+
+// --------------------------------------------------------------------------
+
+class TextLayout
+{
+    std::vector<PlacedGlyph> m_glyphs;
+    float m_width;
+
+    // extra space added after every glyph, in EM units
+    float m_tracking;
+
+    // per-line scratch space
+    std::vector<int>   m_characters;
+    std::vector<float> m_advances;
+
+public:
+    TextLayout();
+
+    // lays out the given UTF-8 text as a single line starting at the origin,
+    // replacing the previous layout
+    void LayoutLine(GlyphExtractor &extractor, const std::string &text);
+
+    void SetTracking(float tracking)    { m_tracking = tracking; }
+
+    // the placed glyphs, and the distance from the start of the line to the
+    // pen position after the last glyph
+    const std::vector<PlacedGlyph> &Glyphs() const  { return m_glyphs; }
+    float Width() const                             { return m_width; }
+};
+
+// --------------------------------------------------------------------------
+#endif // TEXTLAYOUT_H
@@ -0,0 +1,129 @@
+// ==========================================================================
+// Text Stream
+//
+// Reads UTF-8 text that arrives over time, from standard input or from a
+// file that another program keeps appending to, without ever blocking the
+// render loop. Each Read takes whatever bytes are available and returns the
+// whole characters among them; a character split between two reads is held
+// back until the rest of it arrives.
+// ==========================================================================
+
+#include "TextStream.h"
+#include "Utf8.h"
+#include <cerrno>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+TextStream::TextStream()
+    : m_fd(-1), m_ownsFd(false), m_savedFlags(-1), m_follow(false), m_closed(false)
+{}
+
+TextStream::~TextStream()
+{
+    Close();
+}
+
+bool TextStream::OpenStandardInput()
+{
+    Close();
+
+    int flags = fcntl(STDIN_FILENO, F_GETFL);
+    if (flags < 0 || fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK) < 0) {
+        cout << "TextStream ERROR: Could not make standard input non-blocking" << endl;
+        return false;
+    }
+
+    m_fd = STDIN_FILENO;
+    m_ownsFd = false;
+    m_savedFlags = flags;
+    m_follow = false;
+    return true;
+}
+
+bool TextStream::Open(const string &filename)
+{
+    Close();
+
+    m_fd = open(filename.c_str(), O_RDONLY | O_NONBLOCK);
+    if (m_fd < 0) {
+        cout << "TextStream ERROR: Could not open " << filename << endl;
+        return false;
+    }
+
+    m_ownsFd = true;
+    m_follow = true;
+    return true;
+}
+
+void TextStream::Close()
+{
+    if (m_fd >= 0 && m_ownsFd)
+        close(m_fd);
+    else if (m_fd >= 0 && m_savedFlags >= 0)
+        fcntl(m_fd, F_SETFL, m_savedFlags);
+    m_fd = -1;
+    m_savedFlags = -1;
+    m_ownsFd = false;
+    m_closed = false;
+    m_partial.clear();
+}
+
+// --------------------------------------------------------------------------
+
+// length of the leading part of the bytes that ends on a character boundary
+static size_t CompleteLength(const string &bytes)
+{
+    // look back for the lead byte of the last sequence, at most four bytes
+    size_t length = bytes.size();
+    for (size_t back = 1; back <= 4 && back <= length; ++back)
+    {
+        unsigned char c = bytes[length - back];
+        if ((c & 0xC0) == 0x80) continue;
+
+        size_t needed = c < 0x80 ? 1 : c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+        return needed > back ? length - back : length;
+    }
+    return length;
+}
+
+size_t TextStream::Read(vector<int> &characters, size_t maxBytes)
+{
+    if (m_fd < 0 || m_closed)
+        return 0;
+
+    m_bytes.swap(m_partial);
+    m_partial.clear();
+
+    size_t start = m_bytes.size();
+    m_bytes.resize(start + maxBytes);
+    ssize_t count = read(m_fd, &m_bytes[start], maxBytes);
+
+    if (count > 0)
+        m_bytes.resize(start + count);
+    else {
+        m_bytes.resize(start);
+        if (count == 0 && !m_follow)
+            m_closed = true;
+        else if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            m_closed = true;
+    }
+
+    // anything left incomplete at the end of a closed stream is decoded as
+    // it is, which makes it replacement characters
+    size_t complete = m_closed ? m_bytes.size() : CompleteLength(m_bytes);
+    m_partial.assign(m_bytes, complete, string::npos);
+    if (complete == 0)
+        return 0;
+
+    DecodeUtf8(m_bytes.data(), complete, m_decoded);
+    characters.insert(characters.end(), m_decoded.begin(), m_decoded.end());
+    return m_decoded.size();
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,63 @@
+// ==========================================================================
+// Text Stream
+//
+// Reads UTF-8 text that arrives over time, from standard input or from a
+// file that another program keeps appending to, without ever blocking the
+// render loop. Each Read takes whatever bytes are available and returns the
+// whole characters among them; a character split between two reads is held
+// back until the rest of it arrives.
+// ==========================================================================
+#ifndef TEXTSTREAM_H
+#define TEXTSTREAM_H
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------
+
+class TextStream
+{
+    int  m_fd;
+    bool m_ownsFd;
+
+    // file status flags of standard input before it was made non-blocking,
+    // put back on close since the shell shares them
+    int  m_savedFlags;
+
+    // whether the end of a file means "nothing yet" (a file being appended
+    // to) rather than that the stream has closed (a pipe or terminal)
+    bool m_follow;
+    bool m_closed;
+
+    // bytes read that do not make up a whole character yet
+    std::string m_partial;
+
+    // scratch space for decoding
+    std::string m_bytes;
+    std::vector<int> m_decoded;
+
+    TextStream(const TextStream &);
+    TextStream &operator=(const TextStream &);
+
+public:
+    TextStream();
+    ~TextStream();
+
+    // reads standard input
+    bool OpenStandardInput();
+
+    // reads a file from its start, and then whatever is appended to it
+    bool Open(const std::string &filename);
+
+    void Close();
+
+    // appends the characters that can be read right now, reading at most
+    // maxBytes bytes; returns the number of characters appended
+    size_t Read(std::vector<int> &characters, size_t maxBytes = 4096);
+
+    // true once a pipe or terminal has been closed and everything in it read
+    bool Closed() const         { return m_closed; }
+};
+
+// --------------------------------------------------------------------------
+#endif // TEXTSTREAM_H
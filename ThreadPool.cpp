@@ -0,0 +1,81 @@
+// ==========================================================================
+// Thread Pool
+//
+// A fixed set of worker threads that run submitted tasks in the order they
+// were submitted. Wait() blocks until every task submitted so far is done.
+// ==========================================================================
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+ThreadPool::ThreadPool(unsigned int threads)
+    : m_running(0), m_stop(false)
+{
+    if (threads == 0) threads = thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    for (unsigned int i = 0; i < threads; ++i)
+        m_threads.push_back(thread(&ThreadPool::WorkerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(m_lock);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (size_t i = 0; i < m_threads.size(); ++i)
+        m_threads[i].join();
+}
+
+// --------------------------------------------------------------------------
+
+void ThreadPool::Submit(const function<void()> &task)
+{
+    {
+        lock_guard<mutex> lock(m_lock);
+        m_tasks.push_back(task);
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    unique_lock<mutex> lock(m_lock);
+    while (!m_tasks.empty() || m_running > 0)
+        m_idle.wait(lock);
+}
+
+// --------------------------------------------------------------------------
+
+void ThreadPool::WorkerLoop()
+{
+    unique_lock<mutex> lock(m_lock);
+    for (;;)
+    {
+        while (m_tasks.empty() && !m_stop)
+            m_wake.wait(lock);
+
+        // drain the queue before stopping
+        if (m_tasks.empty())
+            return;
+
+        function<void()> task = m_tasks.front();
+        m_tasks.pop_front();
+        ++m_running;
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        --m_running;
+        m_idle.notify_all();
+    }
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,52 @@
+// ==========================================================================
+// Thread Pool
+//
+// A fixed set of worker threads that run submitted tasks in the order they
+// were submitted. Wait() blocks until every task submitted so far is done.
+// ==========================================================================
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------------------------
+
+class ThreadPool
+{
+    std::vector<std::thread> m_threads;
+    std::deque< std::function<void()> > m_tasks;
+
+    std::mutex m_lock;
+    std::condition_variable m_wake;     // signalled when a task is queued
+    std::condition_variable m_idle;     // signalled when a task finishes
+
+    unsigned int m_running;
+    bool m_stop;
+
+    void WorkerLoop();
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+
+public:
+    // starts the given number of threads, or one per core if zero
+    ThreadPool(unsigned int threads = 0);
+
+    // finishes queued tasks, then joins the threads
+    ~ThreadPool();
+
+    void Submit(const std::function<void()> &task);
+
+    // blocks until the queue is empty and no task is running
+    void Wait();
+
+    unsigned int ThreadCount() const    { return m_threads.size(); }
+};
+
+// --------------------------------------------------------------------------
+#endif // THREADPOOL_H
@@ -0,0 +1,136 @@
+// ==========================================================================
+// UTF-8 Decoding
+//
+// Turns UTF-8 text into the code points GlyphExtractor and TextLayout take.
+// Runs of plain ASCII, which is most of the text we draw, are checked and
+// widened sixteen bytes at a time with SSE2 when the compiler targets it;
+// everything else goes through a scalar decoder. Malformed input (stray
+// continuation bytes, truncated or overlong sequences, surrogates, values
+// past U+10FFFF) decodes to U+FFFD, one per bad sequence.
+// ==========================================================================
+
+#include "Utf8.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+// decodes the one sequence starting at text[i], which is not ASCII, and
+// returns the index just past it
+static size_t DecodeSequence(const unsigned char *text, size_t i, size_t length,
+                             int &codePoint)
+{
+    unsigned int lead = text[i];
+    int count;
+    unsigned int value, minimum;
+
+    if (lead >= 0xC2 && lead <= 0xDF)       { count = 1; value = lead & 0x1F; minimum = 0x80; }
+    else if (lead >= 0xE0 && lead <= 0xEF)  { count = 2; value = lead & 0x0F; minimum = 0x800; }
+    else if (lead >= 0xF0 && lead <= 0xF4)  { count = 3; value = lead & 0x07; minimum = 0x10000; }
+    else {
+        // continuation byte without a lead, or a lead that is never valid
+        codePoint = REPLACEMENT_CHARACTER;
+        return i + 1;
+    }
+
+    size_t j = i + 1;
+    for (int k = 0; k < count; ++k, ++j)
+    {
+        // a truncated sequence is replaced, and decoding resumes at the
+        // byte that broke it
+        if (j >= length || (text[j] & 0xC0) != 0x80) {
+            codePoint = REPLACEMENT_CHARACTER;
+            return j;
+        }
+        value = value << 6 | (text[j] & 0x3F);
+    }
+
+    bool valid = value >= minimum && value <= 0x10FFFF &&
+                 !(value >= 0xD800 && value <= 0xDFFF);
+    codePoint = valid ? int(value) : REPLACEMENT_CHARACTER;
+    return j;
+}
+
+void DecodeUtf8(const char *text, size_t length, vector<int> &codePoints)
+{
+    // never more code points than bytes
+    codePoints.resize(length);
+    if (length == 0)
+        return;
+
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(text);
+    int *out = &codePoints[0];
+    size_t i = 0, n = 0;
+
+    while (i < length)
+    {
+#if defined(__SSE2__)
+        // widen sixteen ASCII bytes at a time to 32-bit code points
+        __m128i zero = _mm_setzero_si128();
+        while (i + 16 <= length)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i));
+            if (_mm_movemask_epi8(chunk) != 0)
+                break;
+
+            __m128i low = _mm_unpacklo_epi8(chunk, zero);
+            __m128i high = _mm_unpackhi_epi8(chunk, zero);
+            __m128i *dst = reinterpret_cast<__m128i *>(out + n);
+            _mm_storeu_si128(dst + 0, _mm_unpacklo_epi16(low, zero));
+            _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(low, zero));
+            _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(high, zero));
+            _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(high, zero));
+            i += 16;
+            n += 16;
+        }
+        if (i >= length)
+            break;
+#endif
+
+        // one character at a time until the next chunk might be ASCII
+        // again; at most 16 bytes, so the fast path is retried regularly
+        size_t stop = i + 16 < length ? i + 16 : length;
+        while (i < stop)
+        {
+            if (bytes[i] < 0x80)
+                out[n++] = bytes[i++];
+            else
+                i = DecodeSequence(bytes, i, length, out[n++]);
+        }
+    }
+
+    codePoints.resize(n);
+}
+
+// --------------------------------------------------------------------------
+
+void EncodeUtf8(int codePoint, string &text)
+{
+    unsigned int c = codePoint;
+    if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+        c = REPLACEMENT_CHARACTER;
+
+    if (c < 0x80)
+        text += char(c);
+    else if (c < 0x800) {
+        text += char(0xC0 | c >> 6);
+        text += char(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000) {
+        text += char(0xE0 | c >> 12);
+        text += char(0x80 | (c >> 6 & 0x3F));
+        text += char(0x80 | (c & 0x3F));
+    }
+    else {
+        text += char(0xF0 | c >> 18);
+        text += char(0x80 | (c >> 12 & 0x3F));
+        text += char(0x80 | (c >> 6 & 0x3F));
+        text += char(0x80 | (c & 0x3F));
+    }
+}
+
+// --------------------------------------------------------------------------
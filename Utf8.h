@@ -0,0 +1,35 @@
+// ==========================================================================
+// UTF-8 Decoding
+//
+// Turns UTF-8 text into the code points GlyphExtractor and TextLayout take.
+// Runs of plain ASCII, which is most of the text we draw, are checked and
+// widened sixteen bytes at a time with SSE2 when the compiler targets it;
+// everything else goes through a scalar decoder. Malformed input (stray
+// continuation bytes, truncated or overlong sequences, surrogates, values
+// past U+10FFFF) decodes to U+FFFD, one per bad sequence.
+// ==========================================================================
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------
+
+// code point substituted for malformed input
+static const int REPLACEMENT_CHARACTER = 0xFFFD;
+
+// decodes the given bytes, replacing the contents of codePoints
+void DecodeUtf8(const char *text, size_t length, std::vector<int> &codePoints);
+
+inline void DecodeUtf8(const std::string &text, std::vector<int> &codePoints)
+{
+    DecodeUtf8(text.data(), text.size(), codePoints);
+}
+
+// appends the UTF-8 encoding of a code point to a string
+void EncodeUtf8(int codePoint, std::string &text);
+
+// --------------------------------------------------------------------------
+#endif // UTF8_H
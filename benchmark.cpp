@@ -0,0 +1,276 @@
+// ==========================================================================
+// Glyph Extraction Benchmark
+//
+// Times how long it takes to turn FreeType outlines into segments for the
+// bundled fonts, comparing the point-at-a-time decoder with the batch path
+// that converts a whole outline to EM units (with SIMD) before decoding.
+// Three numbers are reported per font: converting points to EM units alone,
+// decoding into segments, both over outlines that were loaded up front, and
+// full extraction including FT_Load_Glyph. A second table times extracting
+// each font's whole character repertoire one glyph at a time against the
+// parallel batch extraction, and a third compares FreeType's default
+// allocator with the pooling one, along with each font's memory use.
+//
+// Usage: ./benchmark.out [iterations]
+// ==========================================================================
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GlyphExtractor.h"
+#include "OutlineDecoder.h"
+#include FT_OUTLINE_H
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+static const char *FONTS[] = {
+    "Fonts/AlexBrush-Regular.ttf",
+    "Fonts/AquilineTwo.ttf",
+    "Fonts/Lora-Italic.ttf",
+    "Fonts/Inconsolata.otf",
+    "Fonts/KaushanScript-Regular.otf",
+    "Fonts/SourceSansPro-Black.otf",
+};
+
+// characters decoded per pass: printable ASCII and Latin-1
+static const int FIRST_CHARACTER = 0x20;
+static const int LAST_CHARACTER = 0xFF;
+
+static double Milliseconds(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// --------------------------------------------------------------------------
+
+// times converting points and tags of already-loaded outlines to EM units,
+// either one point at a time or with the batch conversion
+static double TimeConvert(const vector<FT_Outline> &outlines, float em,
+                          bool batch, int iterations)
+{
+    EMOutlineBuffer converted;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        for (size_t g = 0; g < outlines.size(); ++g)
+        {
+            const FT_Outline &outline = outlines[g];
+            if (batch)
+                ConvertToEM(outline.points, outline.tags, outline.n_points, em, converted);
+            else
+            {
+                converted.x.resize(outline.n_points);
+                converted.y.resize(outline.n_points);
+                converted.tags.resize(outline.n_points);
+                for (int p = 0; p < outline.n_points; ++p)
+                {
+                    converted.x[p] = outline.points[p].x / em;
+                    converted.y[p] = outline.points[p].y / em;
+                    converted.tags[p] = outline.tags[p] & 3;
+                }
+            }
+        }
+    }
+    return Milliseconds(start);
+}
+
+// times decoding of already-loaded outlines, either way
+static double TimeDecode(const vector<FT_Outline> &outlines, float em,
+                         bool batch, int iterations)
+{
+    vector<MySegment> segments;
+    vector<MyContourSpan> contours;
+    EMOutlineBuffer converted;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        for (size_t g = 0; g < outlines.size(); ++g)
+        {
+            const FT_Outline &outline = outlines[g];
+            segments.clear();
+            contours.clear();
+            FlatSink sink(segments, contours);
+
+            if (batch) {
+                ConvertToEM(outline.points, outline.tags, outline.n_points, em, converted);
+                DecodeOutline(MakeEMOutlineSource(converted, outline.contours, outline.n_contours),
+                              1.0f, sink);
+            }
+            else
+                DecodeOutline(FTOutlineSource(outline), em, sink);
+        }
+    }
+    return Milliseconds(start);
+}
+
+// times full extraction through the GlyphExtractor, either way
+static double TimeExtract(const string &font, bool batch, int iterations)
+{
+    GlyphExtractor extractor;
+    extractor.LoadFontFile(font);
+    extractor.SetBatchConversion(batch);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        for (int c = FIRST_CHARACTER; c <= LAST_CHARACTER; ++c)
+            extractor.ExtractGlyph(c);
+    }
+    return Milliseconds(start);
+}
+
+// times full extraction with FreeType on malloc or on the pooling allocator,
+// filling in the font's memory statistics for the pooled run
+static double TimeAllocator(const string &font, bool pooled, int iterations,
+                            MemoryStats &stats)
+{
+    GlyphExtractor extractor(pooled);
+    extractor.LoadFontFile(font);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        for (int c = FIRST_CHARACTER; c <= LAST_CHARACTER; ++c)
+            extractor.ExtractGlyph(c);
+    }
+    double elapsed = Milliseconds(start);
+
+    if (pooled) stats = extractor.FontMemoryStats(font);
+    return elapsed;
+}
+
+// times extracting every character in a face, one at a time or as a
+// parallel batch
+static double TimeRepertoire(const string &font, const vector<int> &characters,
+                             bool parallel, int iterations)
+{
+    GlyphExtractor extractor;
+    extractor.LoadFontFile(font);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        if (parallel)
+            extractor.ExtractGlyphs(&characters[0], characters.size());
+        else
+            for (size_t c = 0; c < characters.size(); ++c)
+                extractor.ExtractGlyph(characters[c]);
+    }
+    return Milliseconds(start);
+}
+
+// --------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 50;
+
+    FT_Library library;
+    if (FT_Init_FreeType(&library)) {
+        cout << "ERROR: FreeType failed to initialize!" << endl;
+        return -1;
+    }
+
+    cout << "font                              convert: scalar / batch"
+         << "     decode: scalar / batch     extract: scalar / batch" << endl;
+
+    for (size_t f = 0; f < sizeof(FONTS) / sizeof(FONTS[0]); ++f)
+    {
+        FT_Face face;
+        if (FT_New_Face(library, FONTS[f], 0, &face)) {
+            cout << "ERROR: could not open " << FONTS[f] << endl;
+            continue;
+        }
+
+        // load every outline once, keeping copies so decoding can be timed alone
+        vector<FT_Outline> outlines;
+        for (int c = FIRST_CHARACTER; c <= LAST_CHARACTER; ++c)
+        {
+            FT_UInt index = FT_Get_Char_Index(face, c);
+            if (!index || FT_Load_Glyph(face, index, FT_LOAD_NO_SCALE)) continue;
+            const FT_Outline &source = face->glyph->outline;
+
+            FT_Outline copy;
+            FT_Outline_New(library, source.n_points, source.n_contours, &copy);
+            FT_Outline_Copy(&source, &copy);
+            outlines.push_back(copy);
+        }
+
+        float em = face->units_per_EM;
+        double convertScalar = TimeConvert(outlines, em, false, iterations);
+        double convertBatch = TimeConvert(outlines, em, true, iterations);
+        double decodeScalar = TimeDecode(outlines, em, false, iterations);
+        double decodeBatch = TimeDecode(outlines, em, true, iterations);
+        double extractScalar = TimeExtract(FONTS[f], false, iterations);
+        double extractBatch = TimeExtract(FONTS[f], true, iterations);
+
+        string name = FONTS[f];
+        name.resize(32, ' ');
+        cout << name << "  "
+             << convertScalar << " / " << convertBatch << " ms ("
+             << convertScalar / convertBatch << "x)   "
+             << decodeScalar << " / " << decodeBatch << " ms ("
+             << decodeScalar / decodeBatch << "x)   "
+             << extractScalar << " / " << extractBatch << " ms ("
+             << extractScalar / extractBatch << "x)" << endl;
+
+        for (size_t g = 0; g < outlines.size(); ++g)
+            FT_Outline_Done(library, &outlines[g]);
+        FT_Done_Face(face);
+    }
+
+    cout << endl << "font                              repertoire: sequential / parallel ("
+         << thread::hardware_concurrency() << " threads)" << endl;
+
+    int repertoireIterations = iterations / 10 > 0 ? iterations / 10 : 1;
+    for (size_t f = 0; f < sizeof(FONTS) / sizeof(FONTS[0]); ++f)
+    {
+        FT_Face face;
+        if (FT_New_Face(library, FONTS[f], 0, &face)) continue;
+
+        vector<int> characters;
+        FT_UInt index;
+        for (FT_ULong c = FT_Get_First_Char(face, &index); index;
+             c = FT_Get_Next_Char(face, c, &index))
+            characters.push_back(int(c));
+        FT_Done_Face(face);
+        if (characters.empty()) continue;
+
+        double sequential = TimeRepertoire(FONTS[f], characters, false, repertoireIterations);
+        double parallel = TimeRepertoire(FONTS[f], characters, true, repertoireIterations);
+
+        string name = FONTS[f];
+        name.resize(32, ' ');
+        cout << name << "  " << characters.size() << " glyphs  "
+             << sequential << " / " << parallel << " ms ("
+             << sequential / parallel << "x)" << endl;
+    }
+
+    cout << endl << "font                              extract: malloc / pooled"
+         << "     FreeType memory: live / peak, allocations" << endl;
+
+    for (size_t f = 0; f < sizeof(FONTS) / sizeof(FONTS[0]); ++f)
+    {
+        MemoryStats stats;
+        double heap = TimeAllocator(FONTS[f], false, iterations, stats);
+        double pooled = TimeAllocator(FONTS[f], true, iterations, stats);
+
+        string name = FONTS[f];
+        name.resize(32, ' ');
+        cout << name << "  " << heap << " / " << pooled << " ms ("
+             << heap / pooled << "x)   "
+             << stats.liveBytes / 1024 << " / " << stats.peakBytes / 1024 << " KB, "
+             << stats.allocations << endl;
+    }
+
+    FT_Done_FreeType(library);
+    return 0;
+}
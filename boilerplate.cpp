@@ -14,6 +14,7 @@
 // ==========================================================================
 
 
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
@@ -30,6 +31,15 @@
 
 #include "texture.h"
 #include "GlyphExtractor.h"
+#include "ParagraphLayout.h"
+#include "EditableText.h"
+#include "GlyphTicker.h"
+#include "LabelBatch.h"
+#include "OutlineBoxes.h"
+#include "TextDocument.h"
+#include "TextGeometryCache.h"
+#include "TextStream.h"
+#include "Utf8.h"
 
 using namespace std;
 using namespace glm;
@@ -42,17 +52,63 @@ vector<vec3> colours;
 vector<vec3> coloursTwo;
 vector<vec3> coloursThree;
 GlyphExtractor extractor;
+TextGeometryCache textCache;
+const float textScale = 0.5f;
+float lineWidth = 0.0f;
+ParagraphLayout paragraphs;
+string paragraphFont;
+const float paragraphScale = 0.15f;
+float wrapWidth = 1.8f;
+const float paragraphLeft = -0.9f, paragraphTop = 0.9f;
+OutlineBoxes paragraphBoxes;
+TextDocument document;
+const float documentScale = 0.08f;
+float documentScroll = 0.0f;
+const float tickerScale = 0.2f;
+GlyphTicker ticker(tickerScale);
+TextStream tickerStream;
+string tickerSource;
+bool tickerOpened = false;
+const float editorScale = 0.2f;
+EditableText editor(editorScale);
+size_t caret = 0;
+bool editorOpening = false;
+LabelBatch labels;
+vector<vec2> labelVelocities;
+const unsigned int labelCount = 2000;
+const float labelScale = 0.04f;
 bool q1 = true;
 bool q1p1= false;
 bool q2 = false;
 bool q3 = false;
+bool q4 = false;
+bool q5 = false;
+bool q6 = false;
+bool q7 = false;
+bool q8 = false;
 bool borderReached = false;
 float globalDegree = 3.0f; //default case is for quadratic bezier
+// with quadraticOnly, cubics are approximated by quadratics so that every
+// font's text is drawn with 3-point patches
+bool quadraticOnly = false;
+const float quadraticTolerance = 0.001f; // in EM units
+
+// patch size the text scenes build and draw with: the font's own degree,
+// or 3 for any font once its cubics are approximated; the curves of step 1
+// keep globalDegree
+int PatchSize()
+{
+	return quadraticOnly ? 3 : int(globalDegree);
+}
 float translation = 0.0f;
 float speed = 0.02f;
 float sum = 0.0f;
 int click = 0;
 string font = "Fonts/Lora-Italic.ttf";
+const char *fontFiles[] = { "Fonts/Lora-Italic.ttf", "Fonts/KaushanScript-Regular.otf",
+	"Fonts/SourceSansPro-Black.otf", "Fonts/AlexBrush-Regular.ttf",
+	"Fonts/Inconsolata.otf", "Fonts/AquilineTwo.ttf" };
+const int fontCount = sizeof(fontFiles) / sizeof(fontFiles[0]);
 // OpenGL utility and support function prototypes
 
 void QueryGLVersion();
@@ -66,11 +122,12 @@ GLuint LinkProgram2(GLuint vertexShader, GLuint fragmentShader);
 // --------------------------------------------------------------------------
 // Functions to set up OpenGL shader programs for rendering
 
-// load, compile, and link shaders, returning true if successful
-GLuint InitializeShaders()
+// load, compile, and link shaders, returning true if successful; the
+// vertex program can be swapped for another that feeds the same stages
+GLuint InitializeShaders(const string &vertexFile = "shaders/vertex.glsl")
 {
 	// load shader source from files
-	string vertexSource = LoadSource("shaders/vertex.glsl");
+	string vertexSource = LoadSource(vertexFile);
 	string fragmentSource = LoadSource("shaders/fragment.glsl");
 	string tcsSource = LoadSource("shaders/tessControl.glsl");
 	string tesSource = LoadSource("shaders/tessEval.glsl");
@@ -292,6 +349,35 @@ void RenderScene3(Geometry *geometry, GLuint program)
 }
 
 
+// draws cached text geometry, moved by offset (in clip coordinates); pass
+// false for clearScreen to draw over what is already there
+void RenderText(const CachedText &text, GLuint program, vec2 offset, bool clearScreen = true)
+{
+
+	// clear screen to a dark grey colour
+	if (clearScreen) {
+		glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	// bind our shader program and the vertex array object holding the text,
+	// then draw it at the given offset
+	glUseProgram(program);
+	GLint offsetLocation = glGetUniformLocation(program, "offset");
+	glUniform2f(offsetLocation, offset.x, offset.y);
+
+	glBindVertexArray(text.vertexArray);
+	glDrawArrays(GL_PATCHES, 0, text.elementCount);
+
+	// reset state to default (no offset, shader or geometry bound)
+	glUniform2f(offsetLocation, 0.0f, 0.0f);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	// check for an report any OpenGL errors
+	CheckGLErrors();
+}
+
 void RenderSceneOther(Geometry *geometry, GLuint program)
 {
 
@@ -630,120 +716,61 @@ vector<vec3>* coloursThree)
 	}
 }
 
-void generate_text(vector<vec2>* vertexPoints, vector<vec3>* colours, char character, string font, float shift, float clear)
-{
-	if (clear == 1.0f){
-		vertexPoints->clear();
-		colours->clear();
-	}
-
-
-	MyGlyph glyph = extractor.ExtractGlyph(character);
-	float addFac = 1.5f - (clear * shift);
-	float factor = 0.5f;
-	for (int c_index = 0; c_index < glyph.contours.size(); c_index++)
-	{
-		MyContour contour = glyph.contours[c_index];
-
-		for (int s_index = 0; s_index < contour.size(); s_index++)
-		{
-			MySegment segment = contour[s_index];
-
-			for (int i = 0; i <= segment.degree; i++)
-			{
-				if(segment.degree == 1 && globalDegree == 4)
-				{
-					vertexPoints->push_back(vec2((segment.x[i] - addFac ) * factor, segment.y[i]* factor));
-					vertexPoints->push_back(vec2((segment.x[i] - addFac ) * factor, segment.y[i]* factor));
-					colours->push_back(vec3(1.0f,1.0f,1.0f));
-					colours->push_back(vec3(1.0f,1.0f,1.0f));
-				}
-
-				else if(segment.degree == 1 && globalDegree == 3)
-				{
-					vertexPoints->push_back(vec2((segment.x[i] - addFac ) * factor, segment.y[i]* factor));
-					colours->push_back(vec3(1.0f,1.0f,1.0f));
-					if (i == 0)
-					{
-						vertexPoints->push_back(vec2((segment.x[i] - addFac) * factor, segment.y[i]* factor));
-						colours->push_back(vec3(1.0f,1.0f,1.0f));
-					}
-				}
-				else{
-					vertexPoints->push_back(vec2((segment.x[i] - addFac ) * factor, segment.y[i]* factor));
-					colours->push_back(vec3(1.0f,1.0f,1.0f));
-				}
-			}
-		}
-	}
-
+// GLFW callback functions
 
+// reports GLFW errors
+void ErrorCallback(int error, const char* description)
+{
+	cout << "GLFW ERROR " << error << ":" << endl;
+	cout << description << endl;
 }
 
-void generate_text_scroll(vector<vec2>* vertexPoints, vector<vec3>* colours, char character, string font, float shift, float clear)
+// handles mouse button events; in the paragraph view, a click reports the
+// glyph and the curve segment of its outline under the cursor
+void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
-	if (clear == 1.0f ){
-		vertexPoints->clear();
-		colours->clear();
+	if (!q4 || button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS)
+		return;
+
+	// from window pixels to clip coordinates, then to the layout's EM units
+	double cursorX, cursorY;
+	int width, height;
+	glfwGetCursorPos(window, &cursorX, &cursorY);
+	glfwGetWindowSize(window, &width, &height);
+	float x = (2.0f * cursorX / width - 1.0f - paragraphLeft) / paragraphScale;
+	float y = (1.0f - 2.0f * cursorY / height - paragraphTop) / paragraphScale;
+
+	GlyphHit glyph;
+	if (!paragraphs.GlyphAt(x, y, glyph)) {
+		cout << "Nothing under the cursor" << endl;
+		return;
 	}
-
-
-	MyGlyph glyph = extractor.ExtractGlyph(character);
-	float addFac = 1.5f - (clear * shift);
-	float factor = 0.5f;
-	for (int c_index = 0; c_index < glyph.contours.size(); c_index++)
-	{
-		MyContour contour = glyph.contours[c_index];
-
-		for (int s_index = 0; s_index < contour.size(); s_index++)
-		{
-			MySegment segment = contour[s_index];
-
-			for (int i = 0; i <= segment.degree; i++)
-			{
-				if(segment.degree == 1 && globalDegree == 4)
-				{
-					vertexPoints->push_back(vec2((segment.x[i] - addFac + translation) * factor, segment.y[i]* factor));
-					vertexPoints->push_back(vec2((segment.x[i] - addFac + translation) * factor, segment.y[i]* factor));
-					colours->push_back(vec3(1.0f,1.0f,1.0f));
-					colours->push_back(vec3(1.0f,1.0f,1.0f));
-
-				}
-
-				else if(segment.degree == 1 && globalDegree == 3)
-				{
-					vertexPoints->push_back(vec2((segment.x[i] - addFac + translation) * factor, segment.y[i]* factor));
-					colours->push_back(vec3(1.0f,1.0f,1.0f));
-
-					if (i == 0)
-					{
-						vertexPoints->push_back(vec2((segment.x[i] - addFac + translation) * factor, segment.y[i]* factor));
-						colours->push_back(vec3(1.0f,1.0f,1.0f));
-
-					}
-				}
-				else{
-					vertexPoints->push_back(vec2((segment.x[i] - addFac + translation) * factor, segment.y[i]* factor));
-					colours->push_back(vec3(1.0f,1.0f,1.0f));
-
-				}
-
-			}
-		}
-	}
-
-
-
+	string character;
+	EncodeUtf8(glyph.character, character);
+	cout << "Clicked '" << character << "' on line " << glyph.line
+		 << ", character " << glyph.index << " of paragraph " << glyph.paragraph;
+
+	// a few pixels either side of a curve count as on it
+	SegmentHit segment;
+	extractor.LoadFontFile(font);
+	if (paragraphBoxes.SegmentAt(extractor, glyph.character, x - glyph.x, y - glyph.y,
+	                             4.0f / (height * paragraphScale), segment))
+		cout << ", contour " << segment.contour << " segment " << segment.segment;
+	cout << endl;
 }
 
-
-// GLFW callback functions
-
-// reports GLFW errors
-void ErrorCallback(int error, const char* description)
+// handles text input events; typed characters go into the editor at the caret
+void CharCallback(GLFWwindow* window, unsigned int codePoint)
 {
-	cout << "GLFW ERROR " << error << ":" << endl;
-	cout << description << endl;
+	// the E that opened the editor arrives here too, in the same batch of
+	// events, and is not typed
+	if (!q7 || editorOpening)
+		return;
+
+	string typed;
+	EncodeUtf8(int(codePoint), typed);
+	if (editor.Insert(extractor, font, PatchSize(), caret, typed))
+		++caret;
 }
 
 // handles keyboard input events
@@ -752,12 +779,53 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, GL_TRUE);
 
+	// while editing, keys edit the text and move the caret rather than
+	// switching scenes; tab leaves the editor
+	else if(q7 && key != GLFW_KEY_TAB)
+	{
+		if (action != GLFW_PRESS && action != GLFW_REPEAT)
+			return;
+		if (key == GLFW_KEY_BACKSPACE && caret > 0) {
+			--caret;
+			editor.Erase(extractor, font, PatchSize(), caret, 1);
+		}
+		else if (key == GLFW_KEY_DELETE)
+			editor.Erase(extractor, font, PatchSize(), caret, 1);
+		else if (key == GLFW_KEY_LEFT && caret > 0) --caret;
+		else if (key == GLFW_KEY_RIGHT && caret < editor.Length()) ++caret;
+		else if (key == GLFW_KEY_HOME) caret = 0;
+		else if (key == GLFW_KEY_END) caret = editor.Length();
+	}
+
+	else if(q7 && key == GLFW_KEY_TAB && action == GLFW_PRESS)
+	{
+		q1 = true;
+		q7 = false;
+		q8 = false;
+		globalDegree = 3;
+	}
+
+	else if(key == GLFW_KEY_Q && action == GLFW_PRESS)
+	{
+		quadraticOnly = !quadraticOnly;
+		extractor.SetQuadraticTolerance(quadraticOnly ? quadraticTolerance : 0.0f);
+		// text built with the old setting is built again
+		textCache.Clear();
+		paragraphBoxes.Clear();
+		cout << (quadraticOnly ? "Drawing cubics as quadratics" : "Drawing cubics as cubics") << endl;
+	}
+
 	else if(key == GLFW_KEY_1 && action == GLFW_PRESS)
 	{
 		q1 = true;
 		q1p1 = false;
 		q2 = false;
 		q3 = false;
+		q4 = false;
+		q5 = false;
+		q6 = false;
+		q7 = false;
+		q8 = false;
 		globalDegree = 3;
 
 	}
@@ -767,6 +835,11 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 		q1 = true;
 		q2 = false;
 		q3 = false;
+		q4 = false;
+		q5 = false;
+		q6 = false;
+		q7 = false;
+		q8 = false;
 		globalDegree = 4;
 
 	}
@@ -781,6 +854,11 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 		q1 = false;
 		q2 = true;
 		q3 = false;
+		q4 = false;
+		q5 = false;
+		q6 = false;
+		q7 = false;
+		q8 = false;
 		globalDegree = 3; //since ttf files use quadratic bezier
 		font = "Fonts/Lora-Italic.ttf";
 
@@ -794,6 +872,11 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 		q1 = false;
 		q2 = true;
 		q3 = false;
+		q4 = false;
+		q5 = false;
+		q6 = false;
+		q7 = false;
+		q8 = false;
 		globalDegree = 4; //since otf files use cubic bezier
 		font = "Fonts/KaushanScript-Regular.otf";
 
@@ -807,6 +890,11 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 		q1 = false;
 		q2 = true;
 		q3 = false;
+		q4 = false;
+		q5 = false;
+		q6 = false;
+		q7 = false;
+		q8 = false;
 		globalDegree = 4;
 		font = "Fonts/SourceSansPro-Black.otf"; //since otf files use cubic bezier
 
@@ -818,6 +906,11 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 		q1 = false;
 		q2 = false;
 		q3 = true;
+		q4 = false;
+		q5 = false;
+		q6 = false;
+		q7 = false;
+		q8 = false;
 		globalDegree = 3;
 		font = "Fonts/AlexBrush-Regular.ttf";
 
@@ -830,6 +923,11 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 		q1 = false;
 		q2 = false;
 		q3 = true;
+		q4 = false;
+		q5 = false;
+		q6 = false;
+		q7 = false;
+		q8 = false;
 		globalDegree = 4;
 		font = "Fonts/Inconsolata.otf";
 
@@ -843,20 +941,122 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 		q1 = false;
 		q2 = false;
 		q3 = true;
+		q4 = false;
+		q5 = false;
+		q6 = false;
+		q7 = false;
+		q8 = false;
 		globalDegree = 3;
 		font = "Fonts/AquilineTwo.ttf";
 
 
 	}
 
+	else if(key == GLFW_KEY_9 && action == GLFW_PRESS)
+	{
+		q1 = false;
+		q2 = false;
+		q3 = false;
+		q4 = true;
+		q5 = false;
+		q6 = false;
+		q7 = false;
+		q8 = false;
+		globalDegree = 3;
+		font = "Fonts/Lora-Italic.ttf";
+	}
+
+	else if(key == GLFW_KEY_0 && action == GLFW_PRESS)
+	{
+		q1 = false;
+		q2 = false;
+		q3 = false;
+		q4 = false;
+		q5 = true;
+		q6 = false;
+		q7 = false;
+		q8 = false;
+		globalDegree = 4;
+		font = "Fonts/SourceSansPro-Black.otf";
+	}
+
+	else if(key == GLFW_KEY_T && action == GLFW_PRESS)
+	{
+		q1 = false;
+		q2 = false;
+		q3 = false;
+		q4 = false;
+		q5 = false;
+		q6 = true;
+		q7 = false;
+		q8 = false;
+		globalDegree = 3;
+		font = "Fonts/Lora-Italic.ttf";
+	}
+
+	else if(key == GLFW_KEY_E && action == GLFW_PRESS)
+	{
+		q1 = false;
+		q2 = false;
+		q3 = false;
+		q4 = false;
+		q5 = false;
+		q6 = false;
+		q7 = true;
+		q8 = false;
+		editorOpening = true;
+		globalDegree = 3;
+		font = "Fonts/Lora-Italic.ttf";
+	}
+
+	else if(key == GLFW_KEY_L && action == GLFW_PRESS)
+	{
+		q1 = false;
+		q2 = false;
+		q3 = false;
+		q4 = false;
+		q5 = false;
+		q6 = false;
+		q7 = false;
+		q8 = true;
+		globalDegree = 4;
+		font = "Fonts/SourceSansPro-Black.otf";
+	}
+
+	// in the document view, up and down scroll by a line, page up and page
+	// down by a screen
+	else if(q5 && (key == GLFW_KEY_UP || key == GLFW_KEY_DOWN || key == GLFW_KEY_PAGE_UP || key == GLFW_KEY_PAGE_DOWN)
+		&& (action == GLFW_PRESS || action == GLFW_REPEAT))
+	{
+		float screen = 2.0f / documentScale;
+		if (key == GLFW_KEY_UP) documentScroll -= 1.0f;
+		else if (key == GLFW_KEY_DOWN) documentScroll += 1.0f;
+		else if (key == GLFW_KEY_PAGE_UP) documentScroll -= screen;
+		else documentScroll += screen;
+		documentScroll = std::max(0.0f, std::min(documentScroll, float(document.LineCount())));
+	}
+
+	// in the paragraph view, left and right narrow and widen the column
+	else if(q4 && (key == GLFW_KEY_LEFT || key == GLFW_KEY_RIGHT) && (action == GLFW_PRESS || action == GLFW_REPEAT))
+	{
+		wrapWidth += (key == GLFW_KEY_RIGHT ? 0.05f : -0.05f);
+		wrapWidth = std::max(0.2f, std::min(wrapWidth, 1.8f));
+	}
+
 	else if(key == GLFW_KEY_RIGHT && (action == GLFW_REPEAT ||  action == GLFW_PRESS))
 	{
 
 		q1 = false;
 		q2 = false;
 		q3 = true;
+		q4 = false;
+		q5 = false;
+		q6 = false;
+		q7 = false;
+		q8 = false;
 		translation-=1.0f * speed;
-		if(translation < -26.4)
+		// start over once the end of the line has scrolled off the left edge
+		if(translation < -(lineWidth + 0.6f))
 		{
 			vertexPoints.clear();
 			colours.clear();
@@ -891,6 +1091,58 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 
 int main(int argc, char *argv[])
 {
+	// read fonts through shared read-only mappings of the files in Fonts/
+	extractor.SetMemoryMappedFonts(true);
+
+	// serve glyphs from precompiled cache files where they have been built
+	// with glyphcache.out; fonts without one are read with FreeType as usual
+	for (int i = 0; i < fontCount; ++i)
+	{
+		string cacheFile = string(fontFiles[i]) + ".glyphs";
+		if (ifstream(cacheFile.c_str()))
+			extractor.UseGlyphCacheFile(cacheFile);
+	}
+
+	// characters a font lacks are taken from the fonts with the widest
+	// coverage instead of coming out as empty glyphs
+	vector<string> fallbackFonts;
+	fallbackFonts.push_back(fontFiles[2]);
+	fallbackFonts.push_back(fontFiles[0]);
+	extractor.SetFallbackFonts(fallbackFonts);
+
+	// extract printable ASCII for every font on worker threads while the
+	// window comes up, so switching fonts with keys 3-8 does not stall
+	vector<string> prewarmFonts(fontFiles, fontFiles + fontCount);
+	vector<int> prewarmCharacters;
+	for (int c = 0x20; c < 0x7F; ++c)
+		prewarmCharacters.push_back(c);
+	extractor.PrewarmFonts(prewarmFonts, prewarmCharacters);
+	bool prewarming = true;
+	int prewarmReported = -1;
+
+	// text for the paragraph view (key 9)
+	paragraphs.SetText(
+		"The quick brown fox jumps over the lazy dog. Pack my box with five "
+		"dozen liquor jugs. How vexingly quick daft zebras jump!\n"
+		"\n"
+		"Sphinx of black quartz, judge my vow. The five boxing wizards jump "
+		"quickly. Jackdaws love my big sphinx of quartz.\n"
+		"Use the left and right arrow keys to change the width of this column, "
+		"and click a letter to see which curve of it is under the cursor.");
+
+	// document for the document view (key 0): the file named on the command
+	// line, or this program's README
+	document.Open(argc > 1 ? argv[1] : "README.md");
+
+	// a screen of document lines takes a few megabytes of patches; leave
+	// room for two so scrolling back and forth does not rebuild them
+	textCache.SetBudget(16 << 20);
+
+	// text for the ticker (key T): the file named second on the command
+	// line, followed as it grows, or standard input
+	if (argc > 2)
+		tickerSource = argv[2];
+
 	// initialize the GLFW windowing system
 	if (!glfwInit()) {
 		cout << "ERROR: GLFW failed to initialize, TERMINATING" << endl;
@@ -914,6 +1166,8 @@ int main(int argc, char *argv[])
 
 	// set keyboard callback function and make our context current (active)
 	glfwSetKeyCallback(window, KeyCallback);
+	glfwSetCharCallback(window, CharCallback);
+	glfwSetMouseButtonCallback(window, MouseButtonCallback);
 	glfwMakeContextCurrent(window);
 
 	//Intialize GLAD
@@ -929,6 +1183,7 @@ int main(int argc, char *argv[])
 	// call function to load and compile shader programs
 	GLuint program = InitializeShaders();
 	GLuint program2 = InitializeShaders2();
+	GLuint labelProgram = InitializeShaders("shaders/labelVertex.glsl");
 
 	if (program == 0) {
 		cout << "Program could not initialize shaders, TERMINATING" << endl;
@@ -936,6 +1191,7 @@ int main(int argc, char *argv[])
 	}
 
 
+
 	// call function to create and fill buffers with geometry data
 
 	if (!InitializeVAO(&MyGeometry))
@@ -945,6 +1201,23 @@ int main(int argc, char *argv[])
 	if (!InitializeVAO(&MyGeometry2))
 			cout << "Program failed to intialize geometry!" << endl;
 
+	if (!ticker.Initialize())
+		cout << "Program failed to intialize the ticker!" << endl;
+
+	if (!editor.Initialize())
+		cout << "Program failed to intialize the editor!" << endl;
+
+	// labels for the label view (key L), scattered over the window, each
+	// drifting its own way
+	if (!labels.Initialize())
+		cout << "Program failed to intialize the labels!" << endl;
+	for (unsigned int i = 0; i < labelCount; ++i)
+	{
+		vec2 position(rand() / float(RAND_MAX) * 1.8f - 1.0f, rand() / float(RAND_MAX) * 2.0f - 1.0f);
+		labels.AddLabel("Label " + to_string(i), position, labelScale);
+		labelVelocities.push_back(vec2(rand() / float(RAND_MAX) - 0.5f, rand() / float(RAND_MAX) - 0.5f) * 0.01f);
+	}
+
 	if(!LoadGeometry(&MyGeometry, vertexPoints.data(), colours.data(), vertexPoints.size()))
 		cout << "Failed to load geometry" << endl;
 
@@ -953,6 +1226,17 @@ int main(int argc, char *argv[])
 	// run an event-triggered main loop
 	while (!glfwWindowShouldClose(window))
 	{
+		// take in fonts as they finish prewarming; glyphs that are not
+		// ready yet are extracted here when they are first drawn
+		if (prewarming)
+		{
+			prewarming = !extractor.CollectPrewarmedFonts();
+			int percent = int(extractor.PrewarmProgress() * 100);
+			if (percent != prewarmReported) {
+				cout << "Prewarming fonts: " << percent << "%" << endl;
+				prewarmReported = percent;
+			}
+		}
 
 		if(q1 == true)
 		{
@@ -975,88 +1259,179 @@ int main(int argc, char *argv[])
 
 		else if (q2 == true)
 		{
-			//
-			extractor.LoadFontFile(font);
-			generate_text(&vertexPoints, &colours, 'A', font, 0.0f,1.0f);
-			generate_text(&vertexPoints, &colours, 'd', font, 0.5f,1.2f);
-			generate_text(&vertexPoints, &colours, 'n', font, 1.0f,1.2f);
-			generate_text(&vertexPoints, &colours, 'a', font, 1.5f,1.2f);
-			generate_text(&vertexPoints, &colours, 'n', font, 2.0f,1.2f);
-			LoadGeometry(&MyGeometry, vertexPoints.data(), colours.data(), vertexPoints.size());
+			// the text is laid out and uploaded once, then drawn from the
+			// cache every frame until the font or degree mode changes
+			const CachedText &text = textCache.Get(extractor, font, "Adnan", textScale, PatchSize());
 			glUseProgram(program);
-			glPatchParameteri(GL_PATCH_VERTICES, globalDegree);
+			glPatchParameteri(GL_PATCH_VERTICES, PatchSize());
 			GLuint degree = glGetUniformLocation(program, "deg");
-			glUniform1ui(degree, globalDegree);
-			RenderSceneOther(&MyGeometry, program);
+			glUniform1ui(degree, PatchSize());
+			RenderText(text, program, vec2(-1.5f * textScale, 0.0f));
 
 		}
 
 		else if (q3 == true)
 		{
 
+			// scrolling only moves the cached geometry, so nothing is rebuilt
+			const CachedText &text = textCache.Get(extractor, font,
+				"The quick brown fox jumps over the lazy dog.", textScale, PatchSize());
+			lineWidth = text.width;
+
+			glUseProgram(program);
+			glPatchParameteri(GL_PATCH_VERTICES, PatchSize());
+			GLuint degree = glGetUniformLocation(program, "deg");
+			glUniform1ui(degree, PatchSize());
+			RenderText(text, program, vec2((-1.5f + translation) * textScale, 0.0f));
+
+
+
+		}
+
+		else if (q4 == true)
+		{
+			// only paragraphs whose line breaks move are wrapped again when
+			// the column width changes, and each line's geometry is cached by
+			// its text, so lines that did not change are not rebuilt either
+			extractor.LoadFontFile(font);
+			if (paragraphFont != font) {
+				paragraphs.Invalidate();
+				paragraphBoxes.Clear();
+				paragraphFont = font;
+			}
+			paragraphs.SetWidth(wrapWidth / paragraphScale);
+			paragraphs.Update(extractor);
+
+			glUseProgram(program);
+			glPatchParameteri(GL_PATCH_VERTICES, PatchSize());
+			GLuint degree = glGetUniformLocation(program, "deg");
+			glUniform1ui(degree, PatchSize());
+
+			// draw the lines between the top of the column and the bottom
+			// of the window
+			size_t last = paragraphs.LineAt(-(paragraphTop + 1.0f) / paragraphScale);
+			glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			for (size_t line = 0; line < paragraphs.LineCount() && line <= last; ++line)
+			{
+				const CachedText &text = textCache.Get(extractor, font,
+					paragraphs.LineText(line), paragraphScale, PatchSize());
+				RenderText(text, program,
+					vec2(paragraphLeft, paragraphTop + paragraphs.Baseline(line) * paragraphScale), false);
+			}
+		}
+
+		else if (q5 == true)
+		{
+			// only the lines on screen are fetched from the document, laid
+			// out and tessellated, and the geometry cache's budget bounds
+			// what is kept of lines scrolled past, so neither memory nor
+			// frame time grows with the size of the document
 			extractor.LoadFontFile(font);
-			generate_text_scroll(&vertexPoints, &colours, 'T', font, 0.0f,1.0f);
-			generate_text_scroll(&vertexPoints, &colours, 'h', font, 0.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'e', font, 1.0f,1.2f);
-
-			generate_text_scroll(&vertexPoints, &colours, ' ', font, 1.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'q', font, 2.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'u', font, 2.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'i', font, 3.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'c', font, 3.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'k', font, 4.0f,1.2f);
-
-			generate_text_scroll(&vertexPoints, &colours, ' ', font, 4.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'b', font, 5.0f,1.2f);
-		  generate_text_scroll(&vertexPoints, &colours, 'r', font, 5.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'o', font, 6.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'w', font, 6.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'n', font, 7.0f,1.2f);
-
-			generate_text_scroll(&vertexPoints, &colours, ' ', font, 7.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'f', font, 8.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'o', font, 8.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'x', font, 9.0f,1.2f);
-
-			generate_text_scroll(&vertexPoints, &colours, ' ', font, 9.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'j', font, 10.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'u', font, 10.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'm', font, 11.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'p', font, 11.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 's', font, 12.0f,1.2f);
-
-			generate_text_scroll(&vertexPoints, &colours, ' ', font, 12.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'o', font, 13.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'v', font, 13.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'e', font, 14.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'r', font, 14.5f,1.2f);
-
-			generate_text_scroll(&vertexPoints, &colours, ' ', font, 15.0f,1.2f);
-		  generate_text_scroll(&vertexPoints, &colours, 't', font, 15.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'h', font, 16.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'e', font, 16.5f,1.2f);
-
-			generate_text_scroll(&vertexPoints, &colours, ' ', font, 17.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'l', font, 17.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'a', font, 18.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'z', font, 18.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'y', font, 19.0f,1.2f);
-
-			generate_text_scroll(&vertexPoints, &colours, ' ', font, 19.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'd', font, 20.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'o', font, 20.5f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, 'g', font, 21.0f,1.2f);
-			generate_text_scroll(&vertexPoints, &colours, '.', font, 21.5f,1.2f);
+			MyFaceMetrics metrics = extractor.GetFaceMetrics();
+			float lineHeight = metrics.ascent - metrics.descent + metrics.lineGap;
 
-			LoadGeometry(&MyGeometry, vertexPoints.data(), colours.data(), vertexPoints.size());
 			glUseProgram(program);
-			glPatchParameteri(GL_PATCH_VERTICES, globalDegree);
+			glPatchParameteri(GL_PATCH_VERTICES, PatchSize());
 			GLuint degree = glGetUniformLocation(program, "deg");
-			glUniform1ui(degree, globalDegree);
-			RenderSceneOther(&MyGeometry, program);
+			glUniform1ui(degree, PatchSize());
+
+			glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+
+			const float left = -0.95f, top = 0.95f;
+			float viewLines = 2.0f / (lineHeight * documentScale);
+			size_t first, end;
+			document.VisibleLines(documentScroll, viewLines, 0, first, end);
+			for (size_t line = first; line < end; ++line)
+			{
+				// nothing past the right edge of the window is laid out
+				const CachedText &text = textCache.Get(extractor, font,
+					document.Line(line, 128), documentScale, PatchSize());
+				float baseline = metrics.ascent + (line - documentScroll) * lineHeight;
+				RenderText(text, program, vec2(left, top - baseline * documentScale), false);
+			}
+		}
+
+		else if (q6 == true)
+		{
+			// the stream is only opened once the ticker is shown, so the
+			// terminal is left alone otherwise
+			if (!tickerOpened) {
+				if (tickerSource.empty()) tickerStream.OpenStandardInput();
+				else tickerStream.Open(tickerSource);
+				tickerOpened = true;
+			}
 
+			// take in text only while the ticker has room for it, so a fast
+			// stream waits in its pipe or file rather than in memory
+			if (ticker.WantsText()) {
+				vector<int> arrived;
+				tickerStream.Read(arrived);
+				if (!arrived.empty())
+					ticker.Push(&arrived[0], arrived.size());
+			}
+
+			// the window is 2 units wide in clip coordinates
+			ticker.Advance(extractor, font, PatchSize(), speed * 2.0f, 2.0f / tickerScale);
+
+			glUseProgram(program);
+			glPatchParameteri(GL_PATCH_VERTICES, PatchSize());
+			GLuint degree = glGetUniformLocation(program, "deg");
+			glUniform1ui(degree, PatchSize());
 
+			glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			ticker.Draw(program, vec2(-1.0f, 0.0f));
+			glUseProgram(0);
+			CheckGLErrors();
+		}
 
+		else if (q7 == true)
+		{
+			// typing and deleting only upload the glyphs typed, and the
+			// glyphs after the caret are moved over as they are drawn, so
+			// an edit costs the same wherever it is in the text
+			editor.Update(extractor, font, PatchSize());
+
+			glUseProgram(program);
+			glPatchParameteri(GL_PATCH_VERTICES, PatchSize());
+			GLuint degree = glGetUniformLocation(program, "deg");
+			glUniform1ui(degree, PatchSize());
+
+			glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			const vec2 origin(-0.9f, 0.0f);
+			editor.Draw(program, origin);
+
+			const CachedText &bar = textCache.Get(extractor, font, "|", editorScale, PatchSize());
+			RenderText(bar, program, origin + vec2(editor.CaretX(caret) * editorScale, 0.0f), false);
+			editorOpening = false;
+		}
+
+		else if (q8 == true)
+		{
+			// every label moves, but only their transforms are uploaded;
+			// the glyphs were built and sorted once, when labels were added
+			for (unsigned int i = 0; i < labelCount; ++i)
+			{
+				vec2 position = labels.LabelPosition(i) + labelVelocities[i];
+				if (position.x < -1.0f || position.x > 0.8f) labelVelocities[i].x = -labelVelocities[i].x;
+				if (position.y < -1.0f || position.y > 1.0f) labelVelocities[i].y = -labelVelocities[i].y;
+				labels.MoveLabel(i, position);
+			}
+			labels.Update(extractor, font, PatchSize());
+
+			glUseProgram(labelProgram);
+			glPatchParameteri(GL_PATCH_VERTICES, PatchSize());
+			GLuint degree = glGetUniformLocation(labelProgram, "deg");
+			glUniform1ui(degree, PatchSize());
+
+			glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			labels.Draw(labelProgram);
+			glUseProgram(0);
+			CheckGLErrors();
 		}
 
 
@@ -1069,11 +1444,17 @@ int main(int argc, char *argv[])
 	}
 
 	// clean up allocated resources before exit
+	textCache.Clear();
+	ticker.Destroy();
+	tickerStream.Close();
+	editor.Destroy();
+	labels.Destroy();
 	DestroyGeometry(&MyGeometry);
 	DestroyGeometry(&MyGeometry2);
 	glUseProgram(0);
 	glDeleteProgram(program);
 	glDeleteProgram(program2);
+	glDeleteProgram(labelProgram);
 	glfwDestroyWindow(window);
 	glfwTerminate();
 
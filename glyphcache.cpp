@@ -0,0 +1,82 @@
+// ==========================================================================
+// Glyph Cache File Builder
+//
+// Extracts a set of characters from a font file and writes them to a glyph
+// cache file next to it (font file name + ".glyphs"), for the runtime to
+// map instead of opening the font with FreeType. See GlyphCacheFile.h for
+// the file layout.
+//
+// Usage: ./glyphcache.out <font file> [first-last | code ...]
+// Codes may be decimal or 0x-prefixed hex; the default set is printable
+// ASCII and Latin-1.
+// ==========================================================================
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "GlyphCacheFile.h"
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+// adds the characters named by one argument, either a code or a range
+static bool AddCharacters(const char *argument, vector<int> &characters)
+{
+    char *end;
+    long first = strtol(argument, &end, 0);
+    long last = first;
+    if (end == argument)
+        return false;
+    if (*end == '-') {
+        const char *next = end + 1;
+        last = strtol(next, &end, 0);
+        if (end == next) return false;
+    }
+    if (*end != '\0' || first < 0 || last < first || last > 0x10FFFF)
+        return false;
+
+    for (long c = first; c <= last; ++c)
+        characters.push_back(int(c));
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        cout << "Usage: " << argv[0] << " <font file> [first-last | code ...]" << endl;
+        return -1;
+    }
+
+    string font = argv[1];
+    vector<int> characters;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (!AddCharacters(argv[i], characters)) {
+            cout << "ERROR: could not read character range " << argv[i] << endl;
+            return -1;
+        }
+    }
+    if (characters.empty()) {
+        AddCharacters("0x20-0x7E", characters);
+        AddCharacters("0xA0-0xFF", characters);
+    }
+
+    GlyphExtractor extractor;
+    if (!extractor.LoadFontFile(font))
+        return -1;
+
+    string output = font + ".glyphs";
+    if (!GlyphCacheFile::Write(output, extractor, font, characters))
+        return -1;
+
+    GlyphCacheHandle file = GlyphCacheFile::Open(output);
+    if (!file)
+        return -1;
+
+    cout << "Wrote " << file->GlyphCount() << " glyphs from " << font
+         << " to " << output << endl;
+    return 0;
+}
@@ -0,0 +1,30 @@
+// ==========================================================================
+// Vertex program for labels drawn by LabelBatch
+//
+// Each glyph of every label is one instance of its character's patches.
+// The patches are in EM units at the origin; the instance gives the pen
+// position within the label and the label's id, which picks the label's
+// position and scale out of the transform buffer.
+// ==========================================================================
+#version 410
+
+layout(location = 0) in vec2 VertexPosition;
+layout(location = 1) in vec3 VertexColour;
+layout(location = 2) in vec2 GlyphPen;
+layout(location = 3) in uint GlyphLabel;
+
+// one texel per label: x and y in clip coordinates, then its scale
+uniform samplerBuffer labelTransforms;
+
+// output to be interpolated between vertices and passed to the fragment stage
+out vec3 tcColour;
+out vec3 Colour;
+
+void main()
+{
+    vec4 transform = texelFetch(labelTransforms, int(GlyphLabel));
+    gl_Position = vec4(transform.xy + transform.z * (VertexPosition + GlyphPen), 0.0, 1.0);
+
+    tcColour = VertexColour;
+    Colour = VertexColour;
+}
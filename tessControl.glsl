@@ -21,13 +21,37 @@ out vec3 teColour[];	//To fragment shader
 //Structs containing the same information which can be written to to send to Tess Eval shader
 //out gl_out[];
 
+//A patch is straight when every control point lies on the line between its
+//ends, in order, as for line segments padded to the patch size by repeating
+//their endpoints. The curve through it is then that line, which needs only
+//one segment instead of 30. How far a control point may stray from the line
+//is relative to the length of the chord between the ends.
+bool Straight()
+{
+	vec2 a = gl_in[0].gl_Position.xy;
+	vec2 d = gl_in[gl_PatchVerticesIn - 1].gl_Position.xy - a;
+	float length2 = dot(d, d);
+	for (int i = 1; i < gl_PatchVerticesIn - 1; ++i)
+	{
+		vec2 p = gl_in[i].gl_Position.xy - a;
+		float along = dot(p, d);
+		//a loop whose ends meet has no line to lie on; only a patch whose
+		//points all coincide is drawn as one
+		if (length2 == 0 && p != vec2(0))
+			return false;
+		if (abs(p.x * d.y - p.y * d.x) > 1e-5 * length2 || along < 0 || along > length2)
+			return false;
+	}
+	return true;
+}
+
 void main()
 {
 	//gl_InvocationID says which vertex in the patch you are processing
 	if(gl_InvocationID == 0)
 	{
 		gl_TessLevelOuter[0] = 1;		//Determines number of lines
-		gl_TessLevelOuter[1] = 30;		//Determines number of segments in line
+		gl_TessLevelOuter[1] = Straight() ? 1 : 30;		//Determines number of segments in line
 	}
 
 	//Passing information along to tessEval.glsl
@@ -11,14 +11,17 @@
 layout(location = 0) in vec2 VertexPosition;
 layout(location = 1) in vec3 VertexColour;
 
+// translation applied to every vertex, used to move cached text geometry
+uniform vec2 offset;
+
 // output to be interpolated between vertices and passed to the fragment stage
 out vec3 tcColour;
 out vec3 Colour;
 
 void main()
 {
-    // assign vertex position without modification
-    gl_Position = vec4(VertexPosition, 0.0, 1.0);
+    // assign vertex position, moved by the offset (zero unless set)
+    gl_Position = vec4(VertexPosition + offset, 0.0, 1.0);
 
     // assign output colour to be interpolated
     tcColour = VertexColour;